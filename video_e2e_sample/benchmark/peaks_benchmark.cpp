@@ -0,0 +1,358 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+/*
+ * Compares the peak search of the human pose postprocessing:
+ *   - the previous findPeaks() on the heatmaps upsampled 4x with cv::INTER_CUBIC: the bounds
+ *     checked neighbours of every pixel, then the suppression of close peaks comparing all pairs
+ *   - human_pose_estimation::findPeaks() on the same upsampled heatmaps: SSE local maxima, then
+ *     the suppression on a grid. The peaks must be identical.
+ *   - human_pose_estimation::findPeaks() on the heatmaps as inferred, refined in windows of the
+ *     upsampled heatmaps. The upsampling isn't needed, the differences to the previous peaks
+ *     are printed.
+ * When the pafs are captured too, the poses of groupPeaksToPoses() on the upsampled maps and
+ * on the maps as inferred are compared as well.
+ *
+ * Without arguments the heatmaps are synthetic. Heatmaps captured from a stream are read from
+ * a file written by OpenCV, for example by adding to HumanPoseEstimator::extractPoses()
+ *   cv::FileStorage("heatmaps.yml", cv::FileStorage::WRITE) << "heatmaps" << heatMaps << "pafs" << pafs;
+ * and running
+ *   peaks_benchmark heatmaps.yml
+ *
+ * It isn't part of the sample project. Build it with OpenCV, for example
+ *   cl /O2 /EHsc /I..\include peaks_benchmark.cpp ..\human_pose\peak.cpp ..\human_pose\human_pose.cpp opencv_world.lib
+ *   g++ -O2 -I../include peaks_benchmark.cpp ../human_pose/peak.cpp ../human_pose/human_pose.cpp `pkg-config --cflags --libs opencv4`
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "peak.hpp"
+
+using human_pose_estimation::HumanPose;
+using human_pose_estimation::Peak;
+
+namespace
+{
+const int ITERATIONS = 200;
+const float MIN_PEAKS_DISTANCE = 3.0f;
+const int UPSAMPLE_RATIO = 4;
+
+// findPeaks() before the SSE search and the grid
+void PreviousFindPeaks(const std::vector<cv::Mat> &heatMaps, const float minPeaksDistance,
+    std::vector<std::vector<Peak> > &allPeaks, int heatMapId)
+{
+    const float threshold = 0.1f;
+    std::vector<cv::Point> peaks;
+    const cv::Mat &heatMap = heatMaps[heatMapId];
+    const float *heatMapData = heatMap.ptr<float>();
+    size_t heatMapStep = heatMap.step1();
+    for (int y = -1; y < heatMap.rows + 1; y++)
+    {
+        for (int x = -1; x < heatMap.cols + 1; x++)
+        {
+            float val = 0;
+            if (x >= 0 && y >= 0 && x < heatMap.cols && y < heatMap.rows)
+            {
+                val = heatMapData[y * heatMapStep + x];
+                val = val >= threshold ? val : 0;
+            }
+            float left_val = 0;
+            if (y >= 0 && x < (heatMap.cols - 1) && y < heatMap.rows)
+            {
+                left_val = heatMapData[y * heatMapStep + x + 1];
+                left_val = left_val >= threshold ? left_val : 0;
+            }
+            float right_val = 0;
+            if (x > 0 && y >= 0 && y < heatMap.rows)
+            {
+                right_val = heatMapData[y * heatMapStep + x - 1];
+                right_val = right_val >= threshold ? right_val : 0;
+            }
+            float top_val = 0;
+            if (x >= 0 && x < heatMap.cols && y < (heatMap.rows - 1))
+            {
+                top_val = heatMapData[(y + 1) * heatMapStep + x];
+                top_val = top_val >= threshold ? top_val : 0;
+            }
+            float bottom_val = 0;
+            if (x >= 0 && y > 0 && x < heatMap.cols)
+            {
+                bottom_val = heatMapData[(y - 1) * heatMapStep + x];
+                bottom_val = bottom_val >= threshold ? bottom_val : 0;
+            }
+            if ((val > left_val) && (val > right_val) && (val > top_val) && (val > bottom_val))
+            {
+                peaks.push_back(cv::Point(x, y));
+            }
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(), [](const cv::Point &a, const cv::Point &b) {
+        return a.x < b.x;
+    });
+    std::vector<bool> isActualPeak(peaks.size(), true);
+    int peakCounter = 0;
+    std::vector<Peak> &peaksWithScoreAndID = allPeaks[heatMapId];
+    for (size_t i = 0; i < peaks.size(); i++)
+    {
+        if (isActualPeak[i])
+        {
+            for (size_t j = i + 1; j < peaks.size(); j++)
+            {
+                if (sqrt((peaks[i].x - peaks[j].x) * (peaks[i].x - peaks[j].x) +
+                         (peaks[i].y - peaks[j].y) * (peaks[i].y - peaks[j].y)) < minPeaksDistance)
+                {
+                    isActualPeak[j] = false;
+                }
+            }
+            peaksWithScoreAndID.push_back(Peak(peakCounter++, peaks[i], heatMap.at<float>(peaks[i])));
+        }
+    }
+}
+
+// Blobs of keypoints over low noise, some of them with flat tops to have equal neighbours.
+// The size of the blobs is the one of the heatmaps as inferred.
+std::vector<cv::Mat> SyntheticHeatMaps(int count, int width, int height)
+{
+    std::vector<cv::Mat> heatMaps;
+    for (int i = 0; i < count; i++)
+    {
+        cv::Mat heatMap(height, width, CV_32FC1);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                heatMap.at<float>(y, x) = (rand() % 1000) / 20000.0f;
+            }
+        }
+        for (int blob = 0; blob < 6; blob++)
+        {
+            const int cx = rand() % width;
+            const int cy = rand() % height;
+            const float sigma = 0.4f + (rand() % 10) / 10.0f;
+            const float peak = 0.15f + (rand() % 85) / 100.0f;
+            const bool flat = (blob % 3 == 0);
+            for (int y = std::max(cy - 4, 0); y < std::min(cy + 5, height); y++)
+            {
+                for (int x = std::max(cx - 4, 0); x < std::min(cx + 5, width); x++)
+                {
+                    float value = peak * std::exp(-((x - cx) * (x - cx) + (y - cy) * (y - cy)) / (2 * sigma * sigma));
+                    if (flat)
+                    {
+                        value = std::floor(value * 8) / 8;
+                    }
+                    heatMap.at<float>(y, x) = std::max(heatMap.at<float>(y, x), value);
+                }
+            }
+        }
+        heatMaps.push_back(heatMap);
+    }
+    return heatMaps;
+}
+
+std::vector<cv::Mat> Upsample(const std::vector<cv::Mat> &maps)
+{
+    std::vector<cv::Mat> upsampled(maps.size());
+    for (size_t i = 0; i < maps.size(); i++)
+    {
+        cv::resize(maps[i], upsampled[i], cv::Size(), UPSAMPLE_RATIO, UPSAMPLE_RATIO, cv::INTER_CUBIC);
+    }
+    return upsampled;
+}
+
+template <typename Func>
+double MeasureMs(Func func)
+{
+    func();
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        func();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count() / ITERATIONS;
+}
+
+bool SamePeaks(const std::vector<Peak> &a, const std::vector<Peak> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].id != b[i].id || a[i].pos != b[i].pos || a[i].score != b[i].score)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The peaks of the maps as inferred that have a previous peak at the same position,
+// and the largest score difference of these
+void MatchPeaks(const std::vector<Peak> &expected, const std::vector<Peak> &peaks, size_t &matched,
+    float &maxScoreDiff)
+{
+    for (const Peak &peak : peaks)
+    {
+        for (const Peak &previous : expected)
+        {
+            if (previous.pos == peak.pos)
+            {
+                matched++;
+                maxScoreDiff = std::max(maxScoreDiff, std::abs(previous.score - peak.score));
+                break;
+            }
+        }
+    }
+}
+
+// The peaks of all heatmaps as extractPoses() numbers them
+void FindAllPeaks(const std::vector<cv::Mat> &heatMaps, int upsampleRatio, std::vector<std::vector<Peak> > &peaks)
+{
+    peaks.assign(heatMaps.size(), std::vector<Peak>());
+    int peaksBefore = 0;
+    for (size_t i = 0; i < heatMaps.size(); i++)
+    {
+        human_pose_estimation::findPeaks(heatMaps, upsampleRatio, MIN_PEAKS_DISTANCE, peaks, (int)i);
+        for (Peak &peak : peaks[i])
+        {
+            peak.id += peaksBefore;
+        }
+        peaksBefore += (int)peaks[i].size();
+    }
+}
+
+void ComparePoses(const std::vector<cv::Mat> &heatMaps, const std::vector<cv::Mat> &pafs)
+{
+    const std::vector<cv::Mat> upsampledHeatMaps = Upsample(heatMaps);
+    const std::vector<cv::Mat> upsampledPafs = Upsample(pafs);
+    std::vector<std::vector<Peak> > expectedPeaks;
+    std::vector<std::vector<Peak> > peaks;
+    FindAllPeaks(upsampledHeatMaps, 1, expectedPeaks);
+    FindAllPeaks(heatMaps, UPSAMPLE_RATIO, peaks);
+    const std::vector<HumanPose> expected = human_pose_estimation::groupPeaksToPoses(expectedPeaks,
+        upsampledPafs, 1, heatMaps.size(), 0.05f, 0.8f, 3, 0.2f);
+    const std::vector<HumanPose> poses = human_pose_estimation::groupPeaksToPoses(peaks,
+        pafs, UPSAMPLE_RATIO, heatMaps.size(), 0.05f, 0.8f, 3, 0.2f);
+
+    printf("\nPoses: %u previous, %u from the maps as inferred\n", (unsigned)expected.size(), (unsigned)poses.size());
+    if (expected.size() != poses.size())
+    {
+        return;
+    }
+    size_t differentKeypoints = 0;
+    float maxScoreDiff = 0;
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        for (size_t k = 0; k < poses[i].keypoints.size(); k++)
+        {
+            differentKeypoints += poses[i].keypoints[k] != expected[i].keypoints[k] ? 1 : 0;
+        }
+        maxScoreDiff = std::max(maxScoreDiff, std::abs(poses[i].score - expected[i].score));
+    }
+    printf("  %u different keypoints, max pose score diff %g\n", (unsigned)differentKeypoints, maxScoreDiff);
+}
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<cv::Mat> heatMaps;
+    std::vector<cv::Mat> pafs;
+    if (argc > 1)
+    {
+        cv::FileStorage storage(argv[1], cv::FileStorage::READ);
+        storage["heatmaps"] >> heatMaps;
+        storage["pafs"] >> pafs;
+        if (heatMaps.empty())
+        {
+            printf("No heatmaps in %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else
+    {
+        // The 18 keypoint maps of human-pose-estimation-0001 for a 456x256 input
+        heatMaps = SyntheticHeatMaps(18, 57, 32);
+    }
+    const std::vector<cv::Mat> upsampled = Upsample(heatMaps);
+
+    const int count = (int)heatMaps.size();
+    printf("%d heatmaps of %dx%d upsampled to %dx%d, %d iterations\n", count, heatMaps[0].cols, heatMaps[0].rows,
+        upsampled[0].cols, upsampled[0].rows, ITERATIONS);
+
+    std::vector<std::vector<Peak> > expected(count);
+    std::vector<std::vector<Peak> > output(count);
+    std::vector<std::vector<Peak> > native(count);
+    size_t peaks = 0;
+    size_t nativePeaks = 0;
+    size_t matched = 0;
+    float maxScoreDiff = 0;
+    bool identical = true;
+    for (int i = 0; i < count; i++)
+    {
+        PreviousFindPeaks(upsampled, MIN_PEAKS_DISTANCE, expected, i);
+        human_pose_estimation::findPeaks(upsampled, 1, MIN_PEAKS_DISTANCE, output, i);
+        human_pose_estimation::findPeaks(heatMaps, UPSAMPLE_RATIO, MIN_PEAKS_DISTANCE, native, i);
+        identical = identical && SamePeaks(expected[i], output[i]);
+        MatchPeaks(expected[i], native[i], matched, maxScoreDiff);
+        peaks += expected[i].size();
+        nativePeaks += native[i].size();
+    }
+
+    double resizeMs = MeasureMs([&]() { Upsample(heatMaps); });
+    double previousMs = MeasureMs([&]() {
+        for (int i = 0; i < count; i++)
+        {
+            expected[i].clear();
+            PreviousFindPeaks(upsampled, MIN_PEAKS_DISTANCE, expected, i);
+        }
+    });
+    double ms = MeasureMs([&]() {
+        for (int i = 0; i < count; i++)
+        {
+            output[i].clear();
+            human_pose_estimation::findPeaks(upsampled, 1, MIN_PEAKS_DISTANCE, output, i);
+        }
+    });
+    double nativeMs = MeasureMs([&]() {
+        for (int i = 0; i < count; i++)
+        {
+            native[i].clear();
+            human_pose_estimation::findPeaks(heatMaps, UPSAMPLE_RATIO, MIN_PEAKS_DISTANCE, native, i);
+        }
+    });
+    printf("  %-28s %8.3f ms\n", "cv::resize of the heatmaps", resizeMs);
+    printf("  %-28s %8.3f ms  %u peaks\n", "previous findPeaks", previousMs, (unsigned)peaks);
+    printf("  %-28s %8.3f ms  x%.1f%s\n", "SSE and grid", ms, previousMs / ms, identical ? "" : "  MISMATCH");
+    printf("  %-28s %8.3f ms  x%.1f with the resize, %u peaks, %u at the previous positions, max score diff %g\n",
+        "maps as inferred", nativeMs, (resizeMs + previousMs) / nativeMs, (unsigned)nativePeaks, (unsigned)matched,
+        maxScoreDiff);
+
+    if (!pafs.empty())
+    {
+        ComparePoses(heatMaps, pafs);
+    }
+    return identical ? 0 : 1;
+}
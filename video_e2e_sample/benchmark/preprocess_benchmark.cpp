@@ -0,0 +1,175 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+/*
+ * Compares the preprocessing of a decoded RGB4 or NV12 frame into a U8 NCHW input blob:
+ *   - the previous path: cvtColor() of the whole frame, resize, then the per-pixel copy
+ *     into the planes done by matU8ToBlob()
+ *   - InferPreprocess::ResizeToPlanarBGR() with every instruction set the CPU supports
+ *
+ * It isn't part of the sample project. Build it with OpenCV, for example
+ *   cl /O2 /EHsc /I..\include preprocess_benchmark.cpp ..\src\infer_preprocess.cpp opencv_world.lib
+ *   g++ -O2 -I../include preprocess_benchmark.cpp ../src/infer_preprocess.cpp `pkg-config --cflags --libs opencv4`
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "infer_preprocess.h"
+
+namespace
+{
+const int ITERATIONS = 200;
+
+struct NetworkInput
+{
+    const char *name;
+    int width;
+    int height;
+};
+
+void PreviousPath(const InferPreprocess::Frame &src, uint8_t *dst, int width, int height)
+{
+    cv::Mat frame(src.height, src.width, CV_8UC3);
+    if (src.format == InferPreprocess::FormatNV12)
+    {
+        // The two planes as one image, the chroma right after the luma
+        cv::Mat frameNV12(src.height * 3 / 2, src.width, CV_8UC1);
+        for (int y = 0; y < src.height; y++)
+        {
+            memcpy(frameNV12.ptr(y), src.data + (size_t)y * src.pitch, src.width);
+        }
+        for (int y = 0; y < src.height / 2; y++)
+        {
+            memcpy(frameNV12.ptr(src.height + y), src.uv + (size_t)y * src.pitch, src.width);
+        }
+        // RGB: the planes of the RGB4 path, see ResizeToPlanarBGR()
+        cv::cvtColor(frameNV12, frame, cv::COLOR_YUV2RGB_NV12);
+    }
+    else
+    {
+        cv::Mat frameRGB4(src.height, src.width, CV_8UC4, (void *)src.data, src.pitch);
+        cv::cvtColor(frameRGB4, frame, cv::COLOR_RGBA2BGR);
+    }
+
+    cv::Mat resized;
+    cv::resize(frame, resized, cv::Size(width, height));
+    for (int c = 0; c < 3; c++)
+    {
+        for (int h = 0; h < height; h++)
+        {
+            for (int w = 0; w < width; w++)
+            {
+                dst[c * width * height + h * width + w] = resized.at<cv::Vec3b>(h, w)[c];
+            }
+        }
+    }
+}
+
+template <typename Func>
+double MeasureMs(Func func)
+{
+    func();
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        func();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count() / ITERATIONS;
+}
+
+void Compare(const char *formatName, const InferPreprocess::Frame &frame)
+{
+    const NetworkInput inputs[] =
+    {
+        { "face-detection-retail-0004", 300, 300 },
+        { "vehicle-license-plate-detection-barrier-0106", 672, 384 },
+        { "human-pose-estimation-0001", 456, 256 },
+    };
+    const char *isaNames[] = { "scalar", "AVX2", "AVX-512" };
+    const int supported = InferPreprocess::SupportedIsa();
+
+    printf("\n%dx%d %s frame, pitch %d, %d iterations\n", frame.width, frame.height, formatName, frame.pitch,
+        ITERATIONS);
+    for (const NetworkInput &input : inputs)
+    {
+        const size_t planeSize = (size_t)input.width * input.height;
+        std::vector<uint8_t> expected(3 * planeSize);
+        std::vector<uint8_t> reference(3 * planeSize);
+        std::vector<uint8_t> output(3 * planeSize);
+
+        printf("\n%s %dx%d\n", input.name, input.width, input.height);
+        double previousMs = MeasureMs([&]() { PreviousPath(frame, expected.data(), input.width, input.height); });
+        printf("  %-28s %8.3f ms\n", "cvtColor+resize+matU8ToBlob", previousMs);
+
+        InferPreprocess::ResizeToPlanarBGR(InferPreprocess::IsaScalar, frame, reference.data(),
+            input.width, input.height, input.width, planeSize);
+        for (int isa = InferPreprocess::IsaScalar; isa <= supported; isa++)
+        {
+            double ms = MeasureMs([&]() {
+                InferPreprocess::ResizeToPlanarBGR((InferPreprocess::Isa)isa, frame, output.data(),
+                    input.width, input.height, input.width, planeSize);
+            });
+
+            int maxDiff = 0;
+            for (size_t i = 0; i < output.size(); i++)
+            {
+                maxDiff = std::max(maxDiff, std::abs(output[i] - expected[i]));
+            }
+            printf("  %-28s %8.3f ms  x%.1f  max diff %d%s\n", isaNames[isa], ms, previousMs / ms, maxDiff,
+                output == reference ? "" : "  MISMATCH with scalar");
+        }
+    }
+}
+}
+
+int main()
+{
+    // A 1080p surface with the pitch aligned as the decoder does
+    const int srcWidth = 1920;
+    const int srcHeight = 1080;
+    const int srcPitch = 2048 * 4;
+    std::vector<uint8_t> surface((size_t)srcPitch * srcHeight);
+    for (int y = 0; y < srcHeight; y++)
+    {
+        for (int x = 0; x < srcWidth * 4; x++)
+        {
+            surface[(size_t)y * srcPitch + x] = (uint8_t)((x * 7 + y * 3 + (rand() & 15)) & 0xFF);
+        }
+    }
+    InferPreprocess::Frame frame = { surface.data(), srcWidth, srcHeight, srcPitch, InferPreprocess::FormatRGB4, NULL };
+    Compare("RGB4", frame);
+
+    // The same size as NV12, the chroma follows the luma in the surface
+    const int nv12Pitch = 2048;
+    std::vector<uint8_t> surfaceNV12((size_t)nv12Pitch * srcHeight * 3 / 2);
+    for (size_t i = 0; i < surfaceNV12.size(); i++)
+    {
+        surfaceNV12[i] = (uint8_t)((i % nv12Pitch * 5 + i / nv12Pitch * 3 + (rand() & 15)) & 0xFF);
+    }
+    InferPreprocess::Frame frameNV12 = { surfaceNV12.data(), srcWidth, srcHeight, nv12Pitch,
+        InferPreprocess::FormatNV12, surfaceNV12.data() + (size_t)nv12Pitch * srcHeight };
+    Compare("NV12", frameNV12);
+    return 0;
+}
@@ -24,12 +24,15 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <samples/ocv_common.hpp>
 #include <samples/common.hpp>
 #include "face_detect.hpp"
+#include "infer_server.h"
+#include "infer_request_pool.h"
+#include "infer_network_registry.h"
+#include "infer_frame_blob.h"
+#include "ssd_decoder.h"
 
 
 using namespace InferenceEngine;
 
-#define SSD_EMPTY_DETECTIONS_INDICATOR -1.0
-
 namespace {
 	cv::Rect TruncateToValidRect(const cv::Rect& rect,
 		const cv::Size& size) {
@@ -61,22 +64,97 @@ namespace {
 }
 
 FaceDetect::FaceDetect(bool enablePerformanceReport)
-	:mDetectThreshold(0.65f),
+	:mDetectThreshold(0.6f),
 	mEnablePerformanceReport(enablePerformanceReport)
 {
 	return;
 }
 
 void FaceDetect::Init(const std::string& detectorModelPath,
-	const std::string& targetDeviceName)
+	const std::string& targetDeviceName, int maxBatch, int maxWaitMs, int numRequests,
+	InferPreprocess::Mode preprocMode, InferPreprocess::Format frameFormat)
 {
-	static std::mutex initLock;
-	std::lock_guard<std::mutex> lock(initLock);
+	mMosaic = mMosaic && !mTiles.IsEnabled();
+	if (mMosaic) {
+		// The sessions of the mosaic fill their tiles of one input
+		mServer = InferServer::Get(detectorModelPath, targetDeviceName, "", InferServer::MosaicMaxTiles, maxWaitMs,
+			SetupNetwork, true);
+		mDetectorNetwork = mServer->Network();
+	}
+	else if (maxBatch > 1 && !mTiles.IsEnabled()) {
+		// Frames of all the sessions using this model are batched by one shared server
+		mServer = InferServer::Get(detectorModelPath, targetDeviceName, "", maxBatch, maxWaitMs, SetupNetwork);
+		mDetectorNetwork = mServer->Network();
+	}
+	else {
+		// One network is shared by all the sessions, each session only has its own requests
+		mPreprocMode = preprocMode;
+		const bool pluginPreproc = (preprocMode == InferPreprocess::ModeIE);
+		// The tiles of a frame are one batch, except for the plugin resizing each tile from its own blob
+		const int batchSize = (mTiles.IsEnabled() && !pluginPreproc) ? mTiles.Count() : 1;
+		const std::string tag = "batch" + std::to_string(batchSize);
+		mNetworkEntry = InferNetworkRegistry::Load(detectorModelPath, targetDeviceName,
+			pluginPreproc ? tag + "|" + InferFrameBlob::NetworkTag(frameFormat) : tag,
+			[pluginPreproc, frameFormat, batchSize](CNNNetwork& network) {
+				SetupNetwork(network);
+				network.setBatchSize(batchSize);
+				if (pluginPreproc) {
+					InferFrameBlob::SetupInput(network.getInputsInfo().begin()->second, frameFormat);
+				}
+			});
+		mDetectorNetwork = mNetworkEntry->network;
+	}
 
-	mDetectorNetwork = ie.ReadNetwork(detectorModelPath); 
-	mDetectorNetwork.setBatchSize(1);
-	
 	InputsDataMap inputInfo(mDetectorNetwork.getInputsInfo());
+	const SizeVector inputDims = inputInfo.begin()->second->getTensorDesc().getDims();
+	mInputSize = cv::Size(static_cast<int>(inputDims[3]), static_cast<int>(inputDims[2]));
+	input_name_ = inputInfo.begin()->first;
+
+	OutputsDataMap outputInfo(mDetectorNetwork.getOutputsInfo());
+	output_name_ = outputInfo.begin()->first;
+	const SizeVector outputDims = outputInfo.begin()->second->getTensorDesc().getDims();
+	max_detections_count_ = outputDims[2];
+	object_size_ = outputDims[3];
+	if (object_size_ != SsdDecoder::DetectionSize) {
+		throw std::logic_error("Face detection output should have 7 as a last dimension");
+	}
+
+	if (mMosaic) {
+		mMosaicRect = DetectionTiles::MosaicRect(mMosaicTile, mInputSize);
+	}
+
+	if (!mServer) {
+		if (mTiles.IsEnabled() && mPreprocMode == InferPreprocess::ModeIE) {
+			numRequests = std::max(numRequests, mTiles.Count());
+		}
+		mRequests.Init(mNetworkEntry->executableNetwork, numRequests);
+	}
+}
+
+void FaceDetect::SetTiles(int cols, int rows, float overlap)
+{
+	mTiles.Set(cols, rows, overlap);
+}
+
+void FaceDetect::SetThreshold(float threshold)
+{
+	mDetectThreshold = threshold;
+}
+
+void FaceDetect::SetInputCache(InferInputCache* cache)
+{
+	mInputCache = cache;
+}
+
+void FaceDetect::SetMosaic(const cv::Rect2f& tile)
+{
+	mMosaic = true;
+	mMosaicTile = tile;
+}
+
+void FaceDetect::SetupNetwork(CNNNetwork& network)
+{
+	InputsDataMap inputInfo(network.getInputsInfo());
 	if (inputInfo.size() != 1) {
 		THROW_IE_EXCEPTION << "Face Detection network should have only one input";
 	}
@@ -84,17 +162,14 @@ void FaceDetect::Init(const std::string& detectorModelPath,
 	inputInfoFirst->setPrecision(Precision::U8);
 	inputInfoFirst->getInputData()->setLayout(Layout::NCHW);
 
-	OutputsDataMap outputInfo(mDetectorNetwork.getOutputsInfo());
+	OutputsDataMap outputInfo(network.getOutputsInfo());
 	if (outputInfo.size() != 1) {
 		THROW_IE_EXCEPTION << "Face Detection network should have only one output";
 	}
 	DataPtr& _output = outputInfo.begin()->second;
-	output_name_ = outputInfo.begin()->first;
 
 	const SizeVector outputDims = _output->getTensorDesc().getDims();
-	max_detections_count_ = outputDims[2];
-	object_size_ = outputDims[3];
-	if (object_size_ != 7) {
+	if (outputDims[3] != 7) {
 		THROW_IE_EXCEPTION << "Face Detection network output layer should have 7 as a last dimension";
 	}
 	if (outputDims.size() != 4) {
@@ -103,10 +178,6 @@ void FaceDetect::Init(const std::string& detectorModelPath,
 	}
 	_output->setPrecision(Precision::FP32);
 	_output->setLayout(TensorDesc::getLayoutByDims(_output->getDims()));
-
-	input_name_ = inputInfo.begin()->first;
-	mVDExecutableNetwork = ie.LoadNetwork(mDetectorNetwork, targetDeviceName);
-	mDetectorRequest = mVDExecutableNetwork.CreateInferRequest();
 }
 
 void FaceDetect::SetSrcImageSize(int width, int height)
@@ -115,60 +186,177 @@ void FaceDetect::SetSrcImageSize(int width, int height)
 	mSrcImageSize.width = 300;// width;
 }
 
-void FaceDetect::Detect(const cv::Mat& image)
+void FaceDetect::Detect(const InferPreprocess::Frame& frame, int region)
 {
-	InferenceEngine::Blob::Ptr input = mDetectorRequest.GetBlob(mDetectorNetwork.getInputsInfo().begin()->first);
-	matU8ToBlob<uint8_t>(image, input);
-	width_ = static_cast<float>(image.cols);
-	height_ = static_cast<float>(image.rows);
-	mDetectorRequest.Infer();
+	if (mTiles.IsEnabled()) {
+		DetectTiles(frame);
+		return;
+	}
+	// The requests in flight keep the size of their own frame
+	const cv::Size frameSize(frame.width, frame.height);
+	const size_t planeSize = static_cast<size_t>(mInputSize.area());
+	// The batch paths parse into their own vector, results holds the faces of the previous frame
+	FDDetectedObjects objects;
+
+	if (mServer && mMosaic) {
+		// Resize here so the server thread only copies the planes into the tile
+		const size_t tileSize = static_cast<size_t>(mMosaicRect.area());
+		mInputPlanes.resize(3 * tileSize);
+		InferInputCache::ResizeToPlanarBGR(mInputCache, frame, mInputPlanes.data(),
+			mMosaicRect.width, mMosaicRect.height, mMosaicRect.width, tileSize);
+		mServer->Infer(
+			[this](Blob::Ptr& input, size_t) {
+				DetectionTiles::CopyToMosaic(mInputPlanes.data(), mMosaicRect, input->buffer().as<uint8_t *>(), mInputSize);
+			},
+			[this, frameSize, &objects](InferRequest& request, size_t batchIdx) {
+				ParseDetections(request.GetBlob(output_name_)->buffer().as<float *>(), static_cast<int>(batchIdx),
+					frameSize, objects);
+			});
+		results.swap(objects);
+		return;
+	}
+	if (mServer) {
+		// Resize here so the server thread only copies the planes into its batch slot
+		mInputPlanes.resize(3 * planeSize);
+		InferInputCache::ResizeToPlanarBGR(mInputCache, frame, mInputPlanes.data(),
+			mInputSize.width, mInputSize.height, mInputSize.width, planeSize);
+		mServer->Infer(
+			[this](Blob::Ptr& input, size_t batchIdx) {
+				std::copy(mInputPlanes.begin(), mInputPlanes.end(),
+					input->buffer().as<uint8_t *>() + batchIdx * mInputPlanes.size());
+			},
+			[this, frameSize, &objects](InferRequest& request, size_t batchIdx) {
+				ParseDetections(request.GetBlob(output_name_)->buffer().as<float *>(), static_cast<int>(batchIdx),
+					frameSize, objects);
+			});
+		results.swap(objects);
+		return;
+	}
 
-	const float *data = mDetectorRequest.GetBlob(output_name_)->buffer().as<float *>();
+	size_t slot = mRequests.Acquire();
+	if (mPreprocMode == InferPreprocess::ModeIE) {
+		mRequests.Request(slot).SetBlob(input_name_, InferFrameBlob::Wrap(frame));
+	}
+	else {
+		InferenceEngine::Blob::Ptr input = mRequests.Request(slot).GetBlob(input_name_);
+		InferInputCache::ResizeToPlanarBGR(mInputCache, frame, input->buffer().as<uint8_t *>(),
+			mInputSize.width, mInputSize.height, mInputSize.width, planeSize);
+	}
+	unsigned int seq = ++mSubmitted;
+	mRequests.StartAsync(slot, [this, seq, region, frameSize](InferRequest& request, size_t) {
+		FDDetectedObjects objects;
+		ParseDetections(request.GetBlob(output_name_)->buffer().as<float *>(), 0, frameSize, objects);
+		// Requests may complete out of order, never replace newer results with older ones
+		std::lock_guard<std::mutex> lock(mResultsLock);
+		LatestResults& latest = mLatestResults[region];
+		if (seq > latest.seq) {
+			latest.seq = seq;
+			latest.objects.swap(objects);
+		}
+	});
+	if (mRequests.Depth() == 1 || mPreprocMode == InferPreprocess::ModeIE) {
+		// The plugin reads the wrapped frame while it infers, and the frame is reused after Detect()
+		mRequests.WaitAll();
+	}
 
-	for (int det_id = 0; det_id < max_detections_count_; ++det_id) {
-			const int start_pos = det_id * object_size_;
+	// With more requests these are the results of the latest completed frame, in the same region
+	std::lock_guard<std::mutex> lock(mResultsLock);
+	results = mLatestResults[region].objects;
+	return;
+}
 
-			const float batchID = data[start_pos];
-			if (batchID == SSD_EMPTY_DETECTIONS_INDICATOR) {
-				break;
+void FaceDetect::DetectTiles(const InferPreprocess::Frame& frame)
+{
+	const std::vector<cv::Rect> tiles = mTiles.Split(frame.width, frame.height);
+	// The tiles have the same size, the detections are scaled to it
+	const cv::Size tileSize = tiles[0].size();
+	std::vector<FDDetectedObjects> tileObjects(tiles.size());
+
+	if (mPreprocMode == InferPreprocess::ModeIE) {
+		for (size_t t = 0; t < tiles.size(); t++) {
+			size_t slot = mRequests.Acquire();
+			mRequests.Request(slot).SetBlob(input_name_,
+				InferFrameBlob::Wrap(frame.Roi(tiles[t].x, tiles[t].y, tiles[t].width, tiles[t].height)));
+			mRequests.StartAsync(slot, [this, t, tileSize, &tileObjects](InferRequest& request, size_t) {
+				ParseDetections(request.GetBlob(output_name_)->buffer().as<float *>(), 0, tileSize, tileObjects[t]);
+			});
+		}
+	}
+	else {
+		const size_t planeSize = static_cast<size_t>(mInputSize.area());
+		size_t slot = mRequests.Acquire();
+		uint8_t *input = mRequests.Request(slot).GetBlob(input_name_)->buffer().as<uint8_t *>();
+		for (size_t t = 0; t < tiles.size(); t++) {
+			InferPreprocess::ResizeToPlanarBGR(frame.Roi(tiles[t].x, tiles[t].y, tiles[t].width, tiles[t].height),
+				input + t * 3 * planeSize, mInputSize.width, mInputSize.height, mInputSize.width, planeSize);
+		}
+		mRequests.StartAsync(slot, [this, tileSize, &tileObjects](InferRequest& request, size_t) {
+			const float *data = request.GetBlob(output_name_)->buffer().as<float *>();
+			for (size_t t = 0; t < tileObjects.size(); t++) {
+				ParseDetections(data, static_cast<int>(t), tileSize, tileObjects[t]);
 			}
+		});
+	}
+	mRequests.WaitAll();
+
+	// The faces on the overlaps are detected in more than one tile
+	FDDetectedObjects objects;
+	std::vector<cv::Rect> boxes;
+	std::vector<float> scores;
+	for (size_t t = 0; t < tiles.size(); t++) {
+		for (FDDetectedObject& object : tileObjects[t]) {
+			object.rect += tiles[t].tl();
+			objects.push_back(object);
+			boxes.push_back(object.rect);
+			scores.push_back(object.confidence);
+		}
+	}
+	results.clear();
+	for (size_t i : DetectionTiles::NonMaxSuppression(boxes, scores)) {
+		results.push_back(objects[i]);
+	}
+}
 
-			const float score = std::min(std::max(0.0f, data[start_pos + 2]), 1.0f);
-			const float x0 =
-				std::min(std::max(0.0f, data[start_pos + 3]), 1.0f) * width_;
-			const float y0 =
-				std::min(std::max(0.0f, data[start_pos + 4]), 1.0f) * height_;
-			const float x1 =
-				std::min(std::max(0.0f, data[start_pos + 5]), 1.0f) * width_;
-			const float y1 =
-				std::min(std::max(0.0f, data[start_pos + 6]), 1.0f) * height_;
+void FaceDetect::ParseDetections(const float *data, int batchIdx, const cv::Size& frameSize, FDDetectedObjects& objects)
+{
+	const float width = static_cast<float>(frameSize.width);
+	const float height = static_cast<float>(frameSize.height);
+	SsdDecoder::Decode<SsdDecoder::DetectionSize, SsdDecoder::AnyLabel>(data, max_detections_count_, batchIdx, mDetectThreshold,
+		[this, &objects, &frameSize, width, height](int, float confidence, float nx0, float ny0, float nx1, float ny1) {
+			// The other detections of a mosaic belong to the other sessions
+			if (mMosaic && !DetectionTiles::FromMosaic(mMosaicTile, nx0, ny0, nx1, ny1)) {
+				return true;
+			}
+
+			const float x0 = std::min(std::max(0.0f, nx0), 1.0f) * width;
+			const float y0 = std::min(std::max(0.0f, ny0), 1.0f) * height;
+			const float x1 = std::min(std::max(0.0f, nx1), 1.0f) * width;
+			const float y1 = std::min(std::max(0.0f, ny1), 1.0f) * height;
 
 			FDDetectedObject object;
-			object.confidence = score;
+			object.confidence = std::min(confidence, 1.0f);
 			object.rect = cv::Rect(cv::Point(static_cast<int>(round(static_cast<double>(x0))),
 				static_cast<int>(round(static_cast<double>(y0)))),
 				cv::Point(static_cast<int>(round(static_cast<double>(x1))),
 					static_cast<int>(round(static_cast<double>(y1)))));
 
-
 			object.rect = TruncateToValidRect(IncreaseRect(object.rect,
 				1.15,
 				1.15),
-				cv::Size(static_cast<int>(width_), static_cast<int>(height_)));
+				frameSize);
 
-			if (object.confidence > 0.6 && object.rect.area() > 0) {
-				results.emplace_back(object);
+			if (object.rect.area() > 0) {
+				objects.emplace_back(object);
 			}
-		}
-
-	return;
+			return true;
+		});
 }
 
-void FaceDetect::RenderFDResults(cv::Mat& image)
+void FaceDetect::RenderFDResults(FrameCanvas& image)
 {
 	for (unsigned int i = 0; i < results.size(); i++) {
-		cv::rectangle(image, results[i].rect, cv::Scalar(0, 255, 0), 2);
-		putText(image, "Person", cv::Point(results[i].rect.x, results[i].rect.y), cv::FONT_HERSHEY_PLAIN, 2,
+		image.Rectangle(results[i].rect, cv::Scalar(0, 255, 0), 2);
+		image.Text("Person", cv::Point(results[i].rect.x, results[i].rect.y), cv::FONT_HERSHEY_PLAIN, 2,
 			cv::Scalar(255, 255, 255), 2, cv::LINE_AA);
 	}
 	//cv::rectangle(*image, new_rect, cv::Scalar(255, 255, 255));
@@ -177,5 +365,7 @@ void FaceDetect::RenderFDResults(cv::Mat& image)
 
 FaceDetect::~FaceDetect()
 {
+	// The completion handlers use the members below
+	mRequests.WaitAll();
 	return;
 }
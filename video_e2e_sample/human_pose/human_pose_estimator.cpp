@@ -3,6 +3,7 @@
 //
 
 #include <algorithm>
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -11,14 +12,44 @@
 #include <samples/common.hpp>
 
 #include "human_pose_estimator.hpp"
+#include "infer_server.h"
+#include "infer_request_pool.h"
+#include "infer_network_registry.h"
+#include "infer_frame_blob.h"
 #include "peak.hpp"
 
 namespace human_pose_estimation {
+namespace {
+InferNetworkRegistry::NetworkSetup inputSizeSetup(const cv::Size& layerSize, bool pluginPreproc = false,
+        InferPreprocess::Format frameFormat = InferPreprocess::FormatRGB4) {
+    return [layerSize, pluginPreproc, frameFormat](InferenceEngine::CNNNetwork& net) {
+        net.getInputsInfo().begin()->second->setPrecision(InferenceEngine::Precision::U8);
+        if (pluginPreproc) {
+            InferFrameBlob::SetupInput(net.getInputsInfo().begin()->second, frameFormat);
+        }
+        auto input_shapes = net.getInputShapes();
+        InferenceEngine::SizeVector& input_shape = input_shapes.begin()->second;
+        input_shape[2] = layerSize.height;
+        input_shape[3] = layerSize.width;
+        net.reshape(input_shapes);
+    };
+}
+
+std::string inputSizeTag(const cv::Size& layerSize) {
+    return std::to_string(layerSize.width) + "x" + std::to_string(layerSize.height);
+}
+}  // namespace
+
 const size_t HumanPoseEstimator::keypointsNumber = 18;
 
 HumanPoseEstimator::HumanPoseEstimator(const std::string& modelPath,
                                        const std::string& targetDeviceName_,
-                                       bool enablePerformanceReport)
+                                       bool enablePerformanceReport,
+                                       int maxBatch,
+                                       int maxWaitMs,
+                                       int numRequests,
+                                       InferPreprocess::Mode preprocMode,
+                                       InferPreprocess::Format frameFormat)
     : minJointsNumber(3),
       stride(8),
       pad(cv::Vec4i::all(0)),
@@ -31,85 +62,249 @@ HumanPoseEstimator::HumanPoseEstimator(const std::string& modelPath,
       upsampleRatio(4),
       targetDeviceName(targetDeviceName_),
       enablePerformanceReport(enablePerformanceReport),
-      modelPath(modelPath) {
+      modelPath(modelPath),
+      maxBatch(maxBatch),
+      maxWaitMs(maxWaitMs),
+      numRequests(numRequests),
+      preprocMode(maxBatch > 1 ? InferPreprocess::ModeCPU : preprocMode),
+      frameFormat(frameFormat) {
     if (enablePerformanceReport) {
-        ie.SetConfig({{InferenceEngine::PluginConfigParams::KEY_PERF_COUNT,
-                       InferenceEngine::PluginConfigParams::YES}});
+        loadConfig[InferenceEngine::PluginConfigParams::KEY_PERF_COUNT] = InferenceEngine::PluginConfigParams::YES;
     }
-	InferenceEngine::Core ie;
-	network = ie.ReadNetwork(modelPath); 
-    InferenceEngine::InputInfo::Ptr inputInfo = network.getInputsInfo().begin()->second;
+    // The network to infer with is loaded by the first estimate(), when the input width is known
+    std::shared_ptr<const InferenceEngine::CNNNetwork> network = InferNetworkRegistry::ReadNetwork(modelPath);
+    InferenceEngine::InputInfo::CPtr inputInfo = network->getInputsInfo().begin()->second;
     inputLayerSize = cv::Size(inputInfo->getTensorDesc().getDims()[3], inputInfo->getTensorDesc().getDims()[2]);
-    inputInfo->setPrecision(InferenceEngine::Precision::U8);
+    inputBlobName = network->getInputsInfo().begin()->first;
 
-    InferenceEngine::OutputsDataMap outputInfo = network.getOutputsInfo();
+    InferenceEngine::OutputsDataMap outputInfo = network->getOutputsInfo();
     auto outputBlobsIt = outputInfo.begin();
     pafsBlobName = outputBlobsIt->first;
     heatmapsBlobName = (++outputBlobsIt)->first;
+}
 
-    executableNetwork = ie.LoadNetwork(network, targetDeviceName);
-    request = executableNetwork.CreateInferRequest();
+std::shared_ptr<HumanPoseEstimator::InputShape> HumanPoseEstimator::loadShape(const cv::Size& layerSize) const {
+    // Runs in the background too, only reads the members set by the constructor
+    auto loaded = std::make_shared<InputShape>();
+    if (maxBatch > 1) {
+        // The frames of all sessions with the same input size share one batched network
+        loaded->server = InferServer::Get(modelPath, targetDeviceName, inputSizeTag(layerSize),
+            maxBatch, maxWaitMs, inputSizeSetup(layerSize));
+        return loaded;
+    }
+    // The sessions with the same input size share the network
+    const bool pluginPreproc = (preprocMode == InferPreprocess::ModeIE);
+    loaded->networkEntry = InferNetworkRegistry::Load(modelPath, targetDeviceName,
+        inputSizeTag(layerSize) + (pluginPreproc ? "|" + InferFrameBlob::NetworkTag(frameFormat) : ""),
+        inputSizeSetup(layerSize, pluginPreproc, frameFormat), loadConfig);
+    loaded->requests.Init(loaded->networkEntry->executableNetwork, numRequests);
+    return loaded;
+}
+
+void HumanPoseEstimator::prepare(const cv::Size& imageSize) {
+    const cv::Size layerSize = layerSizeFor(imageSize);
+    if (shapes.count(layerSize.width) || pendingShapes.count(layerSize.width)) {
+        return;
+    }
+    pendingShapes[layerSize.width] = std::async(std::launch::async,
+        &HumanPoseEstimator::loadShape, this, layerSize).share();
 }
 
-std::vector<HumanPose> HumanPoseEstimator::estimate(const cv::Mat& image) {
-    CV_Assert(image.type() == CV_8UC3);
+void HumanPoseEstimator::selectShape(const cv::Size& layerSize) {
+    if (shape && layerSize == inputLayerSize) {
+        return;
+    }
+    auto found = shapes.find(layerSize.width);
+    if (found == shapes.end()) {
+        auto pending = pendingShapes.find(layerSize.width);
+        if (pending == pendingShapes.end()) {
+            pendingShapes[layerSize.width] = std::async(std::launch::async,
+                &HumanPoseEstimator::loadShape, this, layerSize).share();
+            pending = pendingShapes.find(layerSize.width);
+        }
+        // Keep inferring with the current shape until the new one is compiled,
+        // only the very first shape has to be waited for
+        if (shape && pending->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+        std::shared_future<std::shared_ptr<InputShape>> compiled = pending->second;
+        pendingShapes.erase(pending);
+        // Rethrows the exception of a failed compile
+        found = shapes.emplace(layerSize.width, compiled.get()).first;
+    }
+    // The requests of the previous shape complete on their own, it stays in the cache
+    shape = found->second;
+    inputLayerSize = layerSize;
+}
+
+std::vector<HumanPose> HumanPoseEstimator::estimate(const InferPreprocess::Frame& frame) {
+    cv::Size imageSize(frame.width, frame.height);
+    selectShape(layerSizeFor(imageSize));
+    const bool pluginPreproc = (preprocMode == InferPreprocess::ModeIE);
+    // The plugin stretches the whole frame over the input, there is no padding
+    pad = pluginPreproc ? cv::Vec4i::all(0) : padFor(imageSize, inputLayerSize);
+    if (maxBatch > 1) {
+        return estimateBatched(frame, inputCache);
+    }
+    InferRequestPool& requests = shape->requests;
+    size_t slot = requests.Acquire();
+    if (pluginPreproc) {
+        requests.Request(slot).SetBlob(inputBlobName, InferFrameBlob::Wrap(frame));
+    } else {
+        InferenceEngine::Blob::Ptr input = requests.Request(slot).GetBlob(inputBlobName);
+        auto buffer = input->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::U8>::value_type *>();
+        preprocess(frame, buffer, inputCache);
+    }
+
+    unsigned int seq = ++submitted;
+    const cv::Vec4i imagePad = pad;
+    requests.StartAsync(slot, [this, seq, imageSize, imagePad](InferenceEngine::InferRequest& request, size_t) {
+        std::vector<HumanPose> poses = postprocessRequest(request, imageSize, imagePad);
+
+        // Requests may complete out of order, never replace newer poses with older ones
+        std::lock_guard<std::mutex> lock(posesLock);
+        if (seq > completed) {
+            completed = seq;
+            latestPoses.swap(poses);
+        }
+    });
+    if (requests.Depth() == 1 || pluginPreproc) {
+        // The plugin reads the wrapped frame while it infers, and the frame is reused after estimate()
+        requests.WaitAll();
+    }
+
+    // With more requests these are the poses of the latest completed frame
+    std::lock_guard<std::mutex> lock(posesLock);
+    return latestPoses;
+}
 
-    cv::Size imageSize = image.size();
-    if (inputWidthIsChanged(imageSize)) {
-        auto input_shapes = network.getInputShapes();
-        std::string input_name;
-        InferenceEngine::SizeVector input_shape;
-        std::tie(input_name, input_shape) = *input_shapes.begin();
-        input_shape[2] = inputLayerSize.height;
-        input_shape[3] = inputLayerSize.width;
-        input_shapes[input_name] = input_shape;
-        network.reshape(input_shapes);
-        executableNetwork = ie.LoadNetwork(network, targetDeviceName);
-        request = executableNetwork.CreateInferRequest();
+std::vector<std::vector<HumanPose> > HumanPoseEstimator::estimateRois(const InferPreprocess::Frame& frame,
+                                                                       const std::vector<cv::Rect>& rois) {
+    std::vector<std::vector<HumanPose> > roiPoses(rois.size());
+    const bool pluginPreproc = (preprocMode == InferPreprocess::ModeIE);
+    for (size_t i = 0; i < rois.size(); i++) {
+        // The crops aren't the frame the input cache holds the resizes of
+        const cv::Size roiSize(rois[i].width, rois[i].height);
+        const InferPreprocess::Frame crop = frame.Roi(rois[i].x, rois[i].y, roiSize.width, roiSize.height);
+        selectShape(layerSizeFor(roiSize));
+        pad = pluginPreproc ? cv::Vec4i::all(0) : padFor(roiSize, inputLayerSize);
+        if (maxBatch > 1) {
+            roiPoses[i] = estimateBatched(crop, nullptr);
+            continue;
+        }
+        InferRequestPool& requests = shape->requests;
+        size_t slot = requests.Acquire();
+        if (pluginPreproc) {
+            requests.Request(slot).SetBlob(inputBlobName, InferFrameBlob::Wrap(crop));
+        } else {
+            InferenceEngine::Blob::Ptr input = requests.Request(slot).GetBlob(inputBlobName);
+            preprocess(crop, input->buffer().as<uint8_t *>(), nullptr);
+        }
+        const cv::Vec4i roiPad = pad;
+        std::vector<HumanPose>* poses = &roiPoses[i];
+        requests.StartAsync(slot, [this, roiSize, roiPad, poses](InferenceEngine::InferRequest& request, size_t) {
+            *poses = postprocessRequest(request, roiSize, roiPad);
+        });
+    }
+    // A shape compiled meanwhile may have taken over in the middle of the rois
+    for (auto& cached : shapes) {
+        cached.second->requests.WaitAll();
     }
-    InferenceEngine::Blob::Ptr input = request.GetBlob(network.getInputsInfo().begin()->first);
-    auto buffer = input->buffer().as<InferenceEngine::PrecisionTrait<InferenceEngine::Precision::U8>::value_type *>();
-    preprocess(image, buffer);
 
-    request.Infer();
+    for (size_t i = 0; i < rois.size(); i++) {
+        for (auto& pose : roiPoses[i]) {
+            for (auto& keypoint : pose.keypoints) {
+                if (keypoint != cv::Point2f(-1, -1)) {
+                    keypoint.x += rois[i].x;
+                    keypoint.y += rois[i].y;
+                }
+            }
+        }
+    }
+    return roiPoses;
+}
 
+std::vector<HumanPose> HumanPoseEstimator::postprocessRequest(InferenceEngine::InferRequest& request,
+                                                              const cv::Size& imageSize,
+                                                              const cv::Vec4i& imagePad) const {
     InferenceEngine::Blob::Ptr pafsBlob = request.GetBlob(pafsBlobName);
     InferenceEngine::Blob::Ptr heatMapsBlob = request.GetBlob(heatmapsBlobName);
     CV_Assert(heatMapsBlob->getTensorDesc().getDims()[1] == keypointsNumber + 1);
     InferenceEngine::SizeVector heatMapDims =
             heatMapsBlob->getTensorDesc().getDims();
-    std::vector<HumanPose> poses = postprocess(
+    return postprocess(
             heatMapsBlob->buffer(),
             heatMapDims[2] * heatMapDims[3],
             keypointsNumber,
             pafsBlob->buffer(),
             heatMapDims[2] * heatMapDims[3],
             pafsBlob->getTensorDesc().getDims()[1],
-            heatMapDims[3], heatMapDims[2], imageSize);
+            heatMapDims[3], heatMapDims[2], imageSize, imagePad);
+}
 
-    return poses;
+std::vector<HumanPose> HumanPoseEstimator::estimateBatched(const InferPreprocess::Frame& frame,
+                                                           InferInputCache* cache) {
+    // Pre- and postprocessing run in the calling thread, the server thread only copies
+    // the planes into and the feature maps out of the batch
+    inputPlanes.resize(3 * inputLayerSize.area());
+    preprocess(frame, inputPlanes.data(), cache);
+
+    InferenceEngine::SizeVector heatMapDims;
+    size_t nPafs = 0;
+    shape->server->Infer(
+        [this](InferenceEngine::Blob::Ptr& input, size_t batchIdx) {
+            auto buffer = input->buffer().as<uint8_t *>();
+            std::copy(inputPlanes.begin(), inputPlanes.end(), buffer + batchIdx * inputPlanes.size());
+        },
+        [&](InferenceEngine::InferRequest& batchRequest, size_t batchIdx) {
+            InferenceEngine::Blob::Ptr pafsBlob = batchRequest.GetBlob(pafsBlobName);
+            InferenceEngine::Blob::Ptr heatMapsBlob = batchRequest.GetBlob(heatmapsBlobName);
+            heatMapDims = heatMapsBlob->getTensorDesc().getDims();
+            nPafs = pafsBlob->getTensorDesc().getDims()[1];
+            size_t mapSize = heatMapDims[2] * heatMapDims[3];
+            const float* heatMapsData = heatMapsBlob->buffer().as<float *>() + batchIdx * heatMapDims[1] * mapSize;
+            const float* pafsData = pafsBlob->buffer().as<float *>() + batchIdx * nPafs * mapSize;
+            heatMapsCopy.assign(heatMapsData, heatMapsData + heatMapDims[1] * mapSize);
+            pafsCopy.assign(pafsData, pafsData + nPafs * mapSize);
+        });
+    CV_Assert(heatMapDims[1] == keypointsNumber + 1);
+
+    return postprocess(
+            heatMapsCopy.data(),
+            heatMapDims[2] * heatMapDims[3],
+            keypointsNumber,
+            pafsCopy.data(),
+            heatMapDims[2] * heatMapDims[3],
+            static_cast<int>(nPafs),
+            heatMapDims[3], heatMapDims[2], cv::Size(frame.width, frame.height), pad);
 }
 
-void HumanPoseEstimator::preprocess(const cv::Mat& image, uint8_t* buffer) const {
-    cv::Mat resizedImage;
-    double scale = inputLayerSize.height / static_cast<double>(image.rows);
-    cv::resize(image, resizedImage, cv::Size(), scale, scale, cv::INTER_CUBIC);
-    cv::Mat paddedImage;
-    cv::copyMakeBorder(resizedImage, paddedImage, pad(0), pad(2), pad(1), pad(3),
-                       cv::BORDER_CONSTANT, meanPixel);
-    std::vector<cv::Mat> planes(3);
-    for (size_t pId = 0; pId < planes.size(); pId++) {
-        planes[pId] = cv::Mat(inputLayerSize, CV_8UC1,
-                              buffer + pId * inputLayerSize.area());
+void HumanPoseEstimator::preprocess(const InferPreprocess::Frame& frame, uint8_t* buffer,
+                                    InferInputCache* cache) const {
+    // The frame is resized into the unpadded part of the planes, only the padding is filled here
+    const size_t planeSize = static_cast<size_t>(inputLayerSize.area());
+    const int width = inputLayerSize.width;
+    const int height = inputLayerSize.height;
+    for (size_t pId = 0; pId < 3; pId++) {
+        uint8_t* plane = buffer + pId * planeSize;
+        uint8_t mean = cv::saturate_cast<uint8_t>(meanPixel[static_cast<int>(pId)]);
+        std::fill(plane, plane + pad(0) * width, mean);
+        std::fill(plane + (height - pad(2)) * width, plane + planeSize, mean);
+        for (int y = pad(0); y < height - pad(2); y++) {
+            std::fill(plane + y * width, plane + y * width + pad(1), mean);
+            std::fill(plane + (y + 1) * width - pad(3), plane + (y + 1) * width, mean);
+        }
     }
-    cv::split(paddedImage, planes);
+    InferInputCache::ResizeToPlanarBGR(cache, frame, buffer + pad(0) * width + pad(1),
+                                       width - pad(1) - pad(3), height - pad(0) - pad(2),
+                                       width, planeSize);
 }
 
 std::vector<HumanPose> HumanPoseEstimator::postprocess(
         const float* heatMapsData, const int heatMapOffset, const int nHeatMaps,
         const float* pafsData, const int pafOffset, const int nPafs,
         const int featureMapWidth, const int featureMapHeight,
-        const cv::Size& imageSize) const {
+        const cv::Size& imageSize, const cv::Vec4i& imagePad) const {
     std::vector<cv::Mat> heatMaps(nHeatMaps);
     for (size_t i = 0; i < heatMaps.size(); i++) {
         heatMaps[i] = cv::Mat(featureMapHeight, featureMapWidth, CV_32FC1,
@@ -117,7 +312,6 @@ std::vector<HumanPose> HumanPoseEstimator::postprocess(
                                   const_cast<float*>(
                                       heatMapsData + i * heatMapOffset)));
     }
-    resizeFeatureMaps(heatMaps);
 
     std::vector<cv::Mat> pafs(nPafs);
     for (size_t i = 0; i < pafs.size(); i++) {
@@ -126,29 +320,32 @@ std::vector<HumanPose> HumanPoseEstimator::postprocess(
                               const_cast<float*>(
                                   pafsData + i * pafOffset)));
     }
-    resizeFeatureMaps(pafs);
 
+    // The maps aren't upsampled, the peaks and the poses are in the pixels of the upsampled maps
     std::vector<HumanPose> poses = extractPoses(heatMaps, pafs);
-    correctCoordinates(poses, heatMaps[0].size(), imageSize);
+    correctCoordinates(poses, cv::Size(featureMapWidth * upsampleRatio, featureMapHeight * upsampleRatio),
+                       imageSize, imagePad);
     return poses;
 }
 
 class FindPeaksBody: public cv::ParallelLoopBody {
 public:
-    FindPeaksBody(const std::vector<cv::Mat>& heatMaps, float minPeaksDistance,
+    FindPeaksBody(const std::vector<cv::Mat>& heatMaps, int upsampleRatio, float minPeaksDistance,
                   std::vector<std::vector<Peak> >& peaksFromHeatMap)
         : heatMaps(heatMaps),
+          upsampleRatio(upsampleRatio),
           minPeaksDistance(minPeaksDistance),
           peaksFromHeatMap(peaksFromHeatMap) {}
 
     virtual void operator()(const cv::Range& range) const {
         for (int i = range.start; i < range.end; i++) {
-            findPeaks(heatMaps, minPeaksDistance, peaksFromHeatMap, i);
+            findPeaks(heatMaps, upsampleRatio, minPeaksDistance, peaksFromHeatMap, i);
         }
     }
 
 private:
     const std::vector<cv::Mat>& heatMaps;
+    int upsampleRatio;
     float minPeaksDistance;
     std::vector<std::vector<Peak> >& peaksFromHeatMap;
 };
@@ -157,7 +354,7 @@ std::vector<HumanPose> HumanPoseEstimator::extractPoses(
         const std::vector<cv::Mat>& heatMaps,
         const std::vector<cv::Mat>& pafs) const {
     std::vector<std::vector<Peak> > peaksFromHeatMap(heatMaps.size());
-    FindPeaksBody findPeaksBody(heatMaps, minPeaksDistance, peaksFromHeatMap);
+    FindPeaksBody findPeaksBody(heatMaps, upsampleRatio, minPeaksDistance, peaksFromHeatMap);
     cv::parallel_for_(cv::Range(0, static_cast<int>(heatMaps.size())),
                       findPeaksBody);
     int peaksBefore = 0;
@@ -168,70 +365,74 @@ std::vector<HumanPose> HumanPoseEstimator::extractPoses(
         }
     }
     std::vector<HumanPose> poses = groupPeaksToPoses(
-                peaksFromHeatMap, pafs, keypointsNumber, midPointsScoreThreshold,
+                peaksFromHeatMap, pafs, upsampleRatio, keypointsNumber, midPointsScoreThreshold,
                 foundMidPointsRatioThreshold, minJointsNumber, minSubsetScore);
     return poses;
 }
 
-void HumanPoseEstimator::resizeFeatureMaps(std::vector<cv::Mat>& featureMaps) const {
-    for (auto& featureMap : featureMaps) {
-        cv::resize(featureMap, featureMap, cv::Size(),
-                   upsampleRatio, upsampleRatio, cv::INTER_CUBIC);
-    }
-}
-
 void HumanPoseEstimator::correctCoordinates(std::vector<HumanPose>& poses,
                                             const cv::Size& featureMapsSize,
-                                            const cv::Size& imageSize) const {
+                                            const cv::Size& imageSize,
+                                            const cv::Vec4i& imagePad) const {
     CV_Assert(stride % upsampleRatio == 0);
 
     cv::Size fullFeatureMapSize = featureMapsSize * stride / upsampleRatio;
 
     float scaleX = imageSize.width /
-            static_cast<float>(fullFeatureMapSize.width - pad(1) - pad(3));
+            static_cast<float>(fullFeatureMapSize.width - imagePad(1) - imagePad(3));
     float scaleY = imageSize.height /
-            static_cast<float>(fullFeatureMapSize.height - pad(0) - pad(2));
+            static_cast<float>(fullFeatureMapSize.height - imagePad(0) - imagePad(2));
     for (auto& pose : poses) {
         for (auto& keypoint : pose.keypoints) {
             if (keypoint != cv::Point2f(-1, -1)) {
                 keypoint.x *= stride / upsampleRatio;
-                keypoint.x -= pad(1);
+                keypoint.x -= imagePad(1);
                 keypoint.x *= scaleX;
 
                 keypoint.y *= stride / upsampleRatio;
-                keypoint.y -= pad(0);
+                keypoint.y -= imagePad(0);
                 keypoint.y *= scaleY;
             }
         }
     }
 }
 
-bool HumanPoseEstimator::inputWidthIsChanged(const cv::Size& imageSize) {
+cv::Size HumanPoseEstimator::layerSizeFor(const cv::Size& imageSize) const {
+    // The frame is scaled to the height of the model, the width is rounded up to the stride
     double scale = static_cast<double>(inputLayerSize.height) / static_cast<double>(imageSize.height);
-    cv::Size scaledSize(static_cast<int>(cvRound(imageSize.width * scale)),
-                        static_cast<int>(cvRound(imageSize.height * scale)));
-    cv::Size scaledImageSize(std::max(scaledSize.width, inputLayerSize.height),
-                             inputLayerSize.height);
-    int minHeight = std::min(scaledImageSize.height, scaledSize.height);
-    scaledImageSize.width = static_cast<int>(std::ceil(
-                scaledImageSize.width / static_cast<float>(stride))) * stride;
-    pad(0) = static_cast<int>(std::floor((scaledImageSize.height - minHeight) / 2.0));
-    pad(1) = static_cast<int>(std::floor((scaledImageSize.width - scaledSize.width) / 2.0));
-    pad(2) = scaledImageSize.height - minHeight - pad(0);
-    pad(3) = scaledImageSize.width - scaledSize.width - pad(1);
-    if (scaledSize.width == (inputLayerSize.width - pad(1) - pad(3))) {
-        return false;
-    }
+    int scaledWidth = std::max(static_cast<int>(cvRound(imageSize.width * scale)), inputLayerSize.height);
+    return cv::Size(static_cast<int>(std::ceil(scaledWidth / static_cast<float>(stride))) * stride,
+                    inputLayerSize.height);
+}
 
-    inputLayerSize.width = scaledImageSize.width;
-    return true;
+cv::Vec4i HumanPoseEstimator::padFor(const cv::Size& imageSize, const cv::Size& layerSize) const {
+    // Fits the frame into the layer keeping its aspect ratio. For the layer of layerSizeFor()
+    // only the width is padded, a layer of another shape may be padded in height as well
+    double scale = std::min(static_cast<double>(layerSize.height) / static_cast<double>(imageSize.height),
+                            static_cast<double>(layerSize.width) / static_cast<double>(imageSize.width));
+    cv::Size scaledSize(std::min(static_cast<int>(cvRound(imageSize.width * scale)), layerSize.width),
+                        std::min(static_cast<int>(cvRound(imageSize.height * scale)), layerSize.height));
+    cv::Vec4i imagePad;
+    imagePad(0) = (layerSize.height - scaledSize.height) / 2;
+    imagePad(1) = (layerSize.width - scaledSize.width) / 2;
+    imagePad(2) = layerSize.height - scaledSize.height - imagePad(0);
+    imagePad(3) = layerSize.width - scaledSize.width - imagePad(1);
+    return imagePad;
 }
 
 HumanPoseEstimator::~HumanPoseEstimator() {
+    // The completion handlers use the members below
+    for (auto& pending : pendingShapes) {
+        pending.second.wait();
+    }
+    for (auto& cached : shapes) {
+        cached.second->requests.WaitAll();
+    }
     try {
-        if (enablePerformanceReport) {
+        if (enablePerformanceReport && shape && shape->networkEntry) {
             std::cout << "Performance counts for " << modelPath << std::endl << std::endl;
-            printPerformanceCounts(request, std::cout, getFullDeviceName(ie, targetDeviceName), false);
+            printPerformanceCounts(shape->requests.Request(0), std::cout,
+                getFullDeviceName(InferNetworkRegistry::GetCore(), targetDeviceName), false);
         }
     }
     catch (...) {
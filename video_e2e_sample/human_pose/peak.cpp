@@ -3,21 +3,185 @@
 //
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <utility>
 #include <vector>
 
+#include <emmintrin.h>
+
 #include "peak.hpp"
 
 namespace human_pose_estimation {
+namespace {
+// The pixels at or above the threshold that are higher than their four neighbours, row by row.
+// A neighbour below the threshold can't be at or above such a pixel, so comparing with the
+// raw neighbours finds the same pixels as comparing with the neighbours zeroed below the
+// threshold. The rows above and below the map read as -inf. Without Strict, the pixels
+// equal to some of their neighbours are found too.
+template <bool Strict>
+void findLocalMaxima(const cv::Mat& heatMap, const float threshold, std::vector<cv::Point>& peaks) {
+    const int cols = heatMap.cols;
+    const float outsideValue = -std::numeric_limits<float>::infinity();
+    const std::vector<float> outside(cols, outsideValue);
+    const __m128 thresholds = _mm_set1_ps(threshold);
+    for (int y = 0; y < heatMap.rows; y++) {
+        const float* row = heatMap.ptr<float>(y);
+        const float* up = y > 0 ? heatMap.ptr<float>(y - 1) : outside.data();
+        const float* down = y + 1 < heatMap.rows ? heatMap.ptr<float>(y + 1) : outside.data();
+        auto checkPixel = [&](int x) {
+            const float val = row[x];
+            const float left = x > 0 ? row[x - 1] : outsideValue;
+            const float right = x + 1 < cols ? row[x + 1] : outsideValue;
+            if (val >= threshold
+                    && !(Strict ? left >= val : left > val)
+                    && !(Strict ? right >= val : right > val)
+                    && !(Strict ? up[x] >= val : up[x] > val)
+                    && !(Strict ? down[x] >= val : down[x] > val)) {
+                peaks.push_back(cv::Point(x, y));
+            }
+        };
+        if (cols > 0) {
+            checkPixel(0);
+        }
+        int x = 1;
+        // Four pixels at a time, as long as the right neighbours are inside the row
+        for (; x + 4 < cols; x += 4) {
+            const __m128 val = _mm_loadu_ps(row + x);
+            auto notLower = [&val](const __m128 neighbours) {
+                return Strict ? _mm_cmpge_ps(neighbours, val) : _mm_cmpgt_ps(neighbours, val);
+            };
+            const __m128 notHigher = _mm_or_ps(
+                _mm_or_ps(notLower(_mm_loadu_ps(row + x - 1)), notLower(_mm_loadu_ps(row + x + 1))),
+                _mm_or_ps(notLower(_mm_loadu_ps(up + x)), notLower(_mm_loadu_ps(down + x))));
+            const int mask = _mm_movemask_ps(_mm_andnot_ps(notHigher, _mm_cmpge_ps(val, thresholds)));
+            if (mask != 0) {
+                for (int i = 0; i < 4; i++) {
+                    if (mask & (1 << i)) {
+                        peaks.push_back(cv::Point(x + i, y));
+                    }
+                }
+            }
+        }
+        for (; x < cols; x++) {
+            checkPixel(x);
+        }
+    }
+}
+
+// The cubic interpolation between the pixels of a map has its maxima next to the maxima of the
+// map, so the upsampled map is only computed in windows around them. A native maximum somewhat
+// under the threshold may be upsampled above it, and a plateau may be upsampled into a maximum,
+// so the windows are around the maxima at half the threshold that are not lower than their
+// neighbours. The maxima that the ringing of the kernel makes away from them are not found.
+void findUpsampledMaxima(const cv::Mat& heatMap, const UpsampledFeatureMap& upsampled,
+                         const int upsampleRatio, const float threshold,
+                         std::vector<cv::Point>& peaks) {
+    std::vector<cv::Point> nativeMaxima;
+    findLocalMaxima<false>(heatMap, 0.5f * threshold, nativeMaxima);
+
+    // The upsampled pixels within a native pixel of the maximum, and their neighbours
+    const int windowSize = 3 * upsampleRatio + 2;
+    const float outsideValue = -std::numeric_limits<float>::infinity();
+    std::vector<float> window(windowSize * windowSize);
+    for (const auto& maximum : nativeMaxima) {
+        const int left = (maximum.x - 1) * upsampleRatio - 1;
+        const int top = (maximum.y - 1) * upsampleRatio - 1;
+        for (int y = 0; y < windowSize; y++) {
+            for (int x = 0; x < windowSize; x++) {
+                const int upsampledX = left + x;
+                const int upsampledY = top + y;
+                const bool inside = upsampledX >= 0 && upsampledX < upsampled.cols()
+                        && upsampledY >= 0 && upsampledY < upsampled.rows();
+                window[y * windowSize + x] = inside ? upsampled.at(upsampledX, upsampledY) : outsideValue;
+            }
+        }
+        for (int y = 1; y < windowSize - 1; y++) {
+            for (int x = 1; x < windowSize - 1; x++) {
+                const float* center = &window[y * windowSize + x];
+                const float val = *center;
+                if (val >= threshold
+                        && !(center[-1] >= val)
+                        && !(center[1] >= val)
+                        && !(center[-windowSize] >= val)
+                        && !(center[windowSize] >= val)) {
+                    peaks.push_back(cv::Point(left + x, top + y));
+                }
+            }
+        }
+    }
+    // The windows overlap, and the peaks are searched row by row in the upsampled map
+    std::sort(peaks.begin(), peaks.end(), [](const cv::Point& a, const cv::Point& b) {
+        return a.y < b.y || (a.y == b.y && a.x < b.x);
+    });
+    peaks.erase(std::unique(peaks.begin(), peaks.end()), peaks.end());
+}
+
+// The vectors of groupPeaksToPoses(), kept by each thread to not allocate them for every frame
+struct GroupingBuffers {
+    std::vector<Peak> candidates;
+    std::vector<HumanPoseByPeaksIndices> subset;
+    // The subsets with a peak: the first one for each peak, the next one for each subset and keypoint
+    std::vector<int> firstSubsetWithPeak;
+    std::vector<int> nextSubsetWithPeak;
+    std::vector<TwoJointsConnection> connections;
+    std::vector<TwoJointsConnection> tempJointConnections;
+    std::vector<int> occurA;
+    std::vector<int> occurB;
+};
+}  // namespace
+
+UpsampledFeatureMap::UpsampledFeatureMap(const cv::Mat& featureMap, const int upsampleRatio)
+    : featureMap(featureMap),
+      upsampleRatio(upsampleRatio) {
+    CV_Assert(upsampleRatio >= 1 && upsampleRatio <= maxUpsampleRatio);
+    // The source position and the coefficients of cv::resize() for each phase
+    const float A = -0.75f;
+    const double scale = 1.0 / upsampleRatio;
+    for (int phase = 0; phase < upsampleRatio; phase++) {
+        const float position = static_cast<float>((phase + 0.5) * scale - 0.5);
+        const int source = static_cast<int>(std::floor(position));
+        const float x = position - source;
+        float* phaseCoeffs = &coeffs[4 * phase];
+        phaseCoeffs[0] = ((A * (x + 1) - 5 * A) * (x + 1) + 8 * A) * (x + 1) - 4 * A;
+        phaseCoeffs[1] = ((A + 2) * x - (A + 3)) * x * x + 1;
+        phaseCoeffs[2] = ((A + 2) * (1 - x) - (A + 3)) * (1 - x) * (1 - x) + 1;
+        phaseCoeffs[3] = 1.f - phaseCoeffs[0] - phaseCoeffs[1] - phaseCoeffs[2];
+        firstTap[phase] = source - 1;
+    }
+}
+
+float UpsampledFeatureMap::at(const int x, const int y) const {
+    // Rows first then columns as cv::resize(), the pixels past the borders are replicated
+    const int phaseX = x % upsampleRatio;
+    const int phaseY = y % upsampleRatio;
+    const int sourceX = x / upsampleRatio + firstTap[phaseX];
+    const int sourceY = y / upsampleRatio + firstTap[phaseY];
+    const float* alpha = coeffs + 4 * phaseX;
+    const float* beta = coeffs + 4 * phaseY;
+    float value = 0;
+    for (int k = 0; k < 4; k++) {
+        const float* row = featureMap.ptr<float>(std::min(std::max(sourceY + k, 0), featureMap.rows - 1));
+        float rowValue = 0;
+        for (int j = 0; j < 4; j++) {
+            rowValue += row[std::min(std::max(sourceX + j, 0), featureMap.cols - 1)] * alpha[j];
+        }
+        value += beta[k] * rowValue;
+    }
+    return value;
+}
+
 Peak::Peak(const int id, const cv::Point2f& pos, const float score)
     : id(id),
       pos(pos),
       score(score) {}
 
 HumanPoseByPeaksIndices::HumanPoseByPeaksIndices(const int keypointsNumber)
-    : peaksIndices(std::vector<int>(keypointsNumber, -1)),
-      nJoints(0),
-      score(0.0f) {}
+    : nJoints(0),
+      score(0.0f) {
+    CV_Assert(keypointsNumber <= maxKeypointsNumber);
+    peaksIndices.fill(-1);
+}
 
 TwoJointsConnection::TwoJointsConnection(const int firstJointIdx,
                                          const int secondJointIdx,
@@ -27,110 +191,131 @@ TwoJointsConnection::TwoJointsConnection(const int firstJointIdx,
       score(score) {}
 
 void findPeaks(const std::vector<cv::Mat>& heatMaps,
+               const int upsampleRatio,
                const float minPeaksDistance,
                std::vector<std::vector<Peak> >& allPeaks,
                int heatMapId) {
     const float threshold = 0.1f;
     std::vector<cv::Point> peaks;
     const cv::Mat& heatMap = heatMaps[heatMapId];
-    const float* heatMapData = heatMap.ptr<float>();
-    size_t heatMapStep = heatMap.step1();
-    for (int y = -1; y < heatMap.rows + 1; y++) {
-        for (int x = -1; x < heatMap.cols + 1; x++) {
-            float val = 0;
-            if (x >= 0
-                    && y >= 0
-                    && x < heatMap.cols
-                    && y < heatMap.rows) {
-                val = heatMapData[y * heatMapStep + x];
-                val = val >= threshold ? val : 0;
-            }
-
-            float left_val = 0;
-            if (y >= 0
-                    && x < (heatMap.cols - 1)
-                    && y < heatMap.rows) {
-                left_val = heatMapData[y * heatMapStep + x + 1];
-                left_val = left_val >= threshold ? left_val : 0;
-            }
-
-            float right_val = 0;
-            if (x > 0
-                    && y >= 0
-                    && y < heatMap.rows) {
-                right_val = heatMapData[y * heatMapStep + x - 1];
-                right_val = right_val >= threshold ? right_val : 0;
-            }
-
-            float top_val = 0;
-            if (x >= 0
-                    && x < heatMap.cols
-                    && y < (heatMap.rows - 1)) {
-                top_val = heatMapData[(y + 1) * heatMapStep + x];
-                top_val = top_val >= threshold ? top_val : 0;
-            }
-
-            float bottom_val = 0;
-            if (x >= 0
-                    && y > 0
-                    && x < heatMap.cols) {
-                bottom_val = heatMapData[(y - 1) * heatMapStep + x];
-                bottom_val = bottom_val >= threshold ? bottom_val : 0;
-            }
-
-            if ((val > left_val)
-                    && (val > right_val)
-                    && (val > top_val)
-                    && (val > bottom_val)) {
-                peaks.push_back(cv::Point(x, y));
-            }
-        }
+    const UpsampledFeatureMap upsampled(heatMap, upsampleRatio);
+    if (upsampleRatio == 1) {
+        findLocalMaxima<true>(heatMap, threshold, peaks);
+    } else {
+        findUpsampledMaxima(heatMap, upsampled, upsampleRatio, threshold, peaks);
     }
     std::sort(peaks.begin(), peaks.end(), [](const cv::Point& a, const cv::Point& b) {
         return a.x < b.x;
     });
-    std::vector<bool> isActualPeak(peaks.size(), true);
+    // A peak is kept when no kept peak before it is closer than minPeaksDistance. The kept
+    // peaks are put in a grid with cells of that size, the closer ones are in the adjacent cells
+    const int cellSize = static_cast<int>(std::max(1.0f, std::min(std::ceil(minPeaksDistance),
+        static_cast<float>(std::max(upsampled.cols(), upsampled.rows())))));
+    const int gridCols = upsampled.cols() / cellSize + 1;
+    const int gridRows = upsampled.rows() / cellSize + 1;
+    std::vector<int> cellFirstPeak(static_cast<size_t>(gridCols) * gridRows, -1);
+    std::vector<int> nextPeakInCell(peaks.size(), -1);
     int peakCounter = 0;
     std::vector<Peak>& peaksWithScoreAndID = allPeaks[heatMapId];
     for (size_t i = 0; i < peaks.size(); i++) {
-        if (isActualPeak[i]) {
-            for (size_t j = i + 1; j < peaks.size(); j++) {
-                if (sqrt((peaks[i].x - peaks[j].x) * (peaks[i].x - peaks[j].x) +
-                         (peaks[i].y - peaks[j].y) * (peaks[i].y - peaks[j].y)) < minPeaksDistance) {
-                    isActualPeak[j] = false;
+        const int cellX = peaks[i].x / cellSize;
+        const int cellY = peaks[i].y / cellSize;
+        const int lastGridY = std::min(cellY + 1, gridRows - 1);
+        const int lastGridX = std::min(cellX + 1, gridCols - 1);
+        bool isActualPeak = true;
+        for (int gridY = std::max(cellY - 1, 0); gridY <= lastGridY && isActualPeak; gridY++) {
+            for (int gridX = std::max(cellX - 1, 0); gridX <= lastGridX && isActualPeak; gridX++) {
+                for (int j = cellFirstPeak[gridY * gridCols + gridX]; j >= 0; j = nextPeakInCell[j]) {
+                    if (sqrt((peaks[i].x - peaks[j].x) * (peaks[i].x - peaks[j].x) +
+                             (peaks[i].y - peaks[j].y) * (peaks[i].y - peaks[j].y)) < minPeaksDistance) {
+                        isActualPeak = false;
+                        break;
+                    }
                 }
             }
-            peaksWithScoreAndID.push_back(Peak(peakCounter++, peaks[i], heatMap.at<float>(peaks[i])));
+        }
+        if (isActualPeak) {
+            int& cellPeaks = cellFirstPeak[cellY * gridCols + cellX];
+            nextPeakInCell[i] = cellPeaks;
+            cellPeaks = static_cast<int>(i);
+            peaksWithScoreAndID.push_back(Peak(peakCounter++, peaks[i], upsampleRatio == 1 ?
+                heatMap.at<float>(peaks[i]) : upsampled.at(peaks[i].x, peaks[i].y)));
         }
     }
 }
 
 std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >& allPeaks,
                                          const std::vector<cv::Mat>& pafs,
+                                         const int upsampleRatio,
                                          const size_t keypointsNumber,
                                          const float midPointsScoreThreshold,
                                          const float foundMidPointsRatioThreshold,
                                          const int minJointsNumber,
                                          const float minSubsetScore) {
-    const std::vector<std::pair<int, int> > limbIdsHeatmap = {
+    static const std::vector<std::pair<int, int> > limbIdsHeatmap = {
         {2, 3}, {2, 6}, {3, 4}, {4, 5}, {6, 7}, {7, 8}, {2, 9}, {9, 10}, {10, 11}, {2, 12}, {12, 13}, {13, 14},
         {2, 1}, {1, 15}, {15, 17}, {1, 16}, {16, 18}, {3, 17}, {6, 18}
     };
-    const std::vector<std::pair<int, int> > limbIdsPaf = {
+    static const std::vector<std::pair<int, int> > limbIdsPaf = {
         {31, 32}, {39, 40}, {33, 34}, {35, 36}, {41, 42}, {43, 44}, {19, 20}, {21, 22}, {23, 24}, {25, 26},
         {27, 28}, {29, 30}, {47, 48}, {49, 50}, {53, 54}, {51, 52}, {55, 56}, {37, 38}, {45, 46}
     };
 
-    std::vector<Peak> candidates;
+    static thread_local GroupingBuffers buffers;
+    std::vector<Peak>& candidates = buffers.candidates;
+    candidates.clear();
     for (const auto& peaks : allPeaks) {
          candidates.insert(candidates.end(), peaks.begin(), peaks.end());
     }
-    std::vector<HumanPoseByPeaksIndices> subset(0, HumanPoseByPeaksIndices(keypointsNumber));
+
+    // A peak is only ever at the keypoint of its heatmap, so the subsets with a peak at a keypoint
+    // are the subsets with the peak. They are linked for each peak instead of searching them all.
+    std::vector<HumanPoseByPeaksIndices>& subset = buffers.subset;
+    std::vector<int>& firstSubsetWithPeak = buffers.firstSubsetWithPeak;
+    std::vector<int>& nextSubsetWithPeak = buffers.nextSubsetWithPeak;
+    subset.clear();
+    nextSubsetWithPeak.clear();
+    firstSubsetWithPeak.assign(candidates.size(), -1);
+    auto nextWithPeak = [&](const int subsetIdx, const int keypoint) {
+        return nextSubsetWithPeak[subsetIdx * keypointsNumber + keypoint];
+    };
+    auto addSubset = [&](const HumanPoseByPeaksIndices& person) {
+        const int subsetIdx = static_cast<int>(subset.size());
+        subset.push_back(person);
+        nextSubsetWithPeak.resize(subset.size() * keypointsNumber, -1);
+        for (size_t keypoint = 0; keypoint < keypointsNumber; keypoint++) {
+            const int peakIdx = person.peaksIndices[keypoint];
+            if (peakIdx >= 0) {
+                nextSubsetWithPeak[subsetIdx * keypointsNumber + keypoint] = firstSubsetWithPeak[peakIdx];
+                firstSubsetWithPeak[peakIdx] = subsetIdx;
+            }
+        }
+    };
+    auto setPeak = [&](const int subsetIdx, const int keypoint, const int peakIdx) {
+        int& current = subset[subsetIdx].peaksIndices[keypoint];
+        if (current == peakIdx) {
+            return;
+        }
+        if (current >= 0) {
+            int* link = &firstSubsetWithPeak[current];
+            while (*link != subsetIdx) {
+                link = &nextSubsetWithPeak[*link * keypointsNumber + keypoint];
+            }
+            *link = nextSubsetWithPeak[subsetIdx * keypointsNumber + keypoint];
+        }
+        current = peakIdx;
+        nextSubsetWithPeak[subsetIdx * keypointsNumber + keypoint] = firstSubsetWithPeak[peakIdx];
+        firstSubsetWithPeak[peakIdx] = subsetIdx;
+    };
+
     for (size_t k = 0; k < limbIdsPaf.size(); k++) {
-        std::vector<TwoJointsConnection> connections;
+        std::vector<TwoJointsConnection>& connections = buffers.connections;
+        connections.clear();
         const int mapIdxOffset = keypointsNumber + 1;
-        std::pair<cv::Mat, cv::Mat> scoreMid = { pafs[limbIdsPaf[k].first - mapIdxOffset],
-                                                 pafs[limbIdsPaf[k].second - mapIdxOffset] };
+        // Only the few points read along the limbs are upsampled
+        std::pair<UpsampledFeatureMap, UpsampledFeatureMap> scoreMid = {
+            UpsampledFeatureMap(pafs[limbIdsPaf[k].first - mapIdxOffset], upsampleRatio),
+            UpsampledFeatureMap(pafs[limbIdsPaf[k].second - mapIdxOffset], upsampleRatio) };
         const int idxJointA = limbIdsHeatmap[k].first - 1;
         const int idxJointB = limbIdsHeatmap[k].second - 1;
         const std::vector<Peak>& candA = allPeaks[idxJointA];
@@ -142,43 +327,30 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
             continue;
         } else if (nJointsA == 0) {
             for (size_t i = 0; i < nJointsB; i++) {
-                int num = 0;
-                for (size_t j = 0; j < subset.size(); j++) {
-                    if (subset[j].peaksIndices[idxJointB] == candB[i].id) {
-                        num++;
-                        continue;
-                    }
-                }
-                if (num == 0) {
+                if (firstSubsetWithPeak[candB[i].id] < 0) {
                     HumanPoseByPeaksIndices personKeypoints(keypointsNumber);
                     personKeypoints.peaksIndices[idxJointB] = candB[i].id;
                     personKeypoints.nJoints = 1;
                     personKeypoints.score = candB[i].score;
-                    subset.push_back(personKeypoints);
+                    addSubset(personKeypoints);
                 }
             }
             continue;
         } else if (nJointsB == 0) {
             for (size_t i = 0; i < nJointsA; i++) {
-                int num = 0;
-                for (size_t j = 0; j < subset.size(); j++) {
-                    if (subset[j].peaksIndices[idxJointA] == candA[i].id) {
-                        num++;
-                        continue;
-                    }
-                }
-                if (num == 0) {
+                if (firstSubsetWithPeak[candA[i].id] < 0) {
                     HumanPoseByPeaksIndices personKeypoints(keypointsNumber);
                     personKeypoints.peaksIndices[idxJointA] = candA[i].id;
                     personKeypoints.nJoints = 1;
                     personKeypoints.score = candA[i].score;
-                    subset.push_back(personKeypoints);
+                    addSubset(personKeypoints);
                 }
             }
             continue;
         }
 
-        std::vector<TwoJointsConnection> tempJointConnections;
+        std::vector<TwoJointsConnection>& tempJointConnections = buffers.tempJointConnections;
+        tempJointConnections.clear();
         for (size_t i = 0; i < nJointsA; i++) {
             for (size_t j = 0; j < nJointsB; j++) {
                 cv::Point2f pt = candA[i].pos * 0.5 + candB[j].pos * 0.5;
@@ -189,8 +361,8 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
                     continue;
                 }
                 vec /= norm_vec;
-                float score = vec.x * scoreMid.first.at<float>(mid) + vec.y * scoreMid.second.at<float>(mid);
-                int height_n  = pafs[0].rows / 2;
+                float score = vec.x * scoreMid.first.at(mid.x, mid.y) + vec.y * scoreMid.second.at(mid.x, mid.y);
+                int height_n  = pafs[0].rows * upsampleRatio / 2;
                 float suc_ratio = 0.0f;
                 float mid_score = 0.0f;
                 const int mid_num = 10;
@@ -203,12 +375,16 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
                     for (int n = 0; n < mid_num; n++) {
                         cv::Point midPoint(cvRound(candA[i].pos.x + n * step.width),
                                            cvRound(candA[i].pos.y + n * step.height));
-                        cv::Point2f pred(scoreMid.first.at<float>(midPoint),
-                                         scoreMid.second.at<float>(midPoint));
+                        cv::Point2f pred(scoreMid.first.at(midPoint.x, midPoint.y),
+                                         scoreMid.second.at(midPoint.x, midPoint.y));
                         score = vec.x * pred.x + vec.y * pred.y;
                         if (score > midPointsScoreThreshold) {
                             p_sum += score;
                             p_count++;
+                        } else if (foundMidPointsRatioThreshold >= 0.0f) {
+                            // The ratio is an integer division, 0 unless all the points are found,
+                            // so the joints aren't connected. Most pairs in a crowd stop here.
+                            break;
                         }
                     }
                     suc_ratio = static_cast<float>(p_count / mid_num);
@@ -230,8 +406,10 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
         }
         size_t num_limbs = std::min(nJointsA, nJointsB);
         size_t cnt = 0;
-        std::vector<int> occurA(nJointsA, 0);
-        std::vector<int> occurB(nJointsB, 0);
+        std::vector<int>& occurA = buffers.occurA;
+        std::vector<int>& occurB = buffers.occurB;
+        occurA.assign(nJointsA, 0);
+        occurB.assign(nJointsB, 0);
         for (size_t row = 0; row < tempJointConnections.size(); row++) {
             if (cnt == num_limbs) {
                 break;
@@ -253,27 +431,32 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
 
         bool extraJointConnections = (k == 17 || k == 18);
         if (k == 0) {
-            subset = std::vector<HumanPoseByPeaksIndices>(
-                        connections.size(), HumanPoseByPeaksIndices(keypointsNumber));
+            subset.clear();
+            nextSubsetWithPeak.clear();
+            firstSubsetWithPeak.assign(candidates.size(), -1);
             for (size_t i = 0; i < connections.size(); i++) {
                 const int& indexA = connections[i].firstJointIdx;
                 const int& indexB = connections[i].secondJointIdx;
-                subset[i].peaksIndices[idxJointA] = indexA;
-                subset[i].peaksIndices[idxJointB] = indexB;
-                subset[i].nJoints = 2;
-                subset[i].score = candidates[indexA].score + candidates[indexB].score + connections[i].score;
+                HumanPoseByPeaksIndices personKeypoints(keypointsNumber);
+                personKeypoints.peaksIndices[idxJointA] = indexA;
+                personKeypoints.peaksIndices[idxJointB] = indexB;
+                personKeypoints.nJoints = 2;
+                personKeypoints.score = candidates[indexA].score + candidates[indexB].score + connections[i].score;
+                addSubset(personKeypoints);
             }
         } else if (extraJointConnections) {
             for (size_t i = 0; i < connections.size(); i++) {
                 const int& indexA = connections[i].firstJointIdx;
                 const int& indexB = connections[i].secondJointIdx;
-                for (size_t j = 0; j < subset.size(); j++) {
-                    if (subset[j].peaksIndices[idxJointA] == indexA
-                            && subset[j].peaksIndices[idxJointB] == -1) {
-                        subset[j].peaksIndices[idxJointB] = indexB;
-                    } else if (subset[j].peaksIndices[idxJointB] == indexB
-                                && subset[j].peaksIndices[idxJointA] == -1) {
-                        subset[j].peaksIndices[idxJointA] = indexA;
+                // A subset with both peaks already can't miss either of them
+                for (int j = firstSubsetWithPeak[indexA]; j >= 0; j = nextWithPeak(j, idxJointA)) {
+                    if (subset[j].peaksIndices[idxJointB] == -1) {
+                        setPeak(j, idxJointB, indexB);
+                    }
+                }
+                for (int j = firstSubsetWithPeak[indexB]; j >= 0; j = nextWithPeak(j, idxJointB)) {
+                    if (subset[j].peaksIndices[idxJointA] == -1) {
+                        setPeak(j, idxJointA, indexA);
                     }
                 }
             }
@@ -283,13 +466,11 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
                 const int& indexA = connections[i].firstJointIdx;
                 const int& indexB = connections[i].secondJointIdx;
                 bool num = false;
-                for (size_t j = 0; j < subset.size(); j++) {
-                    if (subset[j].peaksIndices[idxJointA] == indexA) {
-                        subset[j].peaksIndices[idxJointB] = indexB;
-                        subset[j].nJoints++;
-                        subset[j].score += candidates[indexB].score + connections[i].score;
-                        num = true;
-                    }
+                for (int j = firstSubsetWithPeak[indexA]; j >= 0; j = nextWithPeak(j, idxJointA)) {
+                    setPeak(j, idxJointB, indexB);
+                    subset[j].nJoints++;
+                    subset[j].score += candidates[indexB].score + connections[i].score;
+                    num = true;
                 }
                 if (!num) {
                     HumanPoseByPeaksIndices hpWithScore(keypointsNumber);
@@ -297,7 +478,7 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
                     hpWithScore.peaksIndices[idxJointB] = indexB;
                     hpWithScore.nJoints = 2;
                     hpWithScore.score = candidates[indexA].score + candidates[indexB].score + connections[i].score;
-                    subset.push_back(hpWithScore);
+                    addSubset(hpWithScore);
                 }
             }
         }
@@ -308,11 +489,10 @@ std::vector<HumanPose> groupPeaksToPoses(const std::vector<std::vector<Peak> >&
                 || subsetI.score / subsetI.nJoints < minSubsetScore) {
             continue;
         }
-        int position = -1;
         HumanPose pose(std::vector<cv::Point2f>(keypointsNumber, cv::Point2f(-1.0f, -1.0f)),
                        subsetI.score * std::max(0, subsetI.nJoints - 1));
-        for (const auto& peakIdx : subsetI.peaksIndices) {
-            position++;
+        for (size_t position = 0; position < keypointsNumber; position++) {
+            const int peakIdx = subsetI.peaksIndices[position];
             if (peakIdx >= 0) {
                 pose.keypoints[position] = candidates[peakIdx].pos;
                 pose.keypoints[position].x += 0.5;
@@ -13,7 +13,7 @@
 using namespace std;
 
 namespace human_pose_estimation {
-	void renderHumanPose(const std::vector<HumanPose>& poses, cv::Mat& image) {
+	void renderHumanPose(const std::vector<HumanPose>& poses, FrameCanvas& image) {
 		//    CV_Assert(image.type() == CV_8UC3);
 
 		static const std::vector<cv::Scalar> colors = {
@@ -44,13 +44,14 @@ namespace human_pose_estimation {
 
 			for (size_t keypointIdx = 0; keypointIdx < pose.keypoints.size(); keypointIdx++) {
 				if (pose.keypoints[keypointIdx] != absentKeypoint) {
-					cv::circle(image, pose.keypoints[keypointIdx], 4, colors[keypointIdx], -1);
+					image.Circle(pose.keypoints[keypointIdx], 4, colors[keypointIdx], -1);
 					//               cout<<"point "<<keypointIdx<<" :("<<pose.keypoints[keypointIdx].x<<","<<pose.keypoints[keypointIdx].y<<"  ";
 				}
 			}
 			//        cout<<"\n";
 		}
-		cv::Mat pane = image.clone();
+		std::vector<std::vector<cv::Point> > polygons;
+		std::vector<cv::Scalar> polygonColors;
 		for (const auto& pose : poses) {
 			for (const auto& limbKeypointsId : limbKeypointsIds) {
 				std::pair<cv::Point2f, cv::Point2f> limbKeypoints(pose.keypoints[limbKeypointsId.first],
@@ -65,13 +66,14 @@ namespace human_pose_estimation {
 				cv::Point difference = limbKeypoints.first - limbKeypoints.second;
 				double length = std::sqrt(difference.x * difference.x + difference.y * difference.y);
 				int angle = static_cast<int>(std::atan2(difference.y, difference.x) * 180 / CV_PI);
-				std::vector<cv::Point> polygon;
+				polygons.emplace_back();
 				cv::ellipse2Poly(cv::Point2d(meanX, meanY), cv::Size2d(length / 2, stickWidth),
-					angle, 0, 360, 1, polygon);
-				cv::fillConvexPoly(pane, polygon, colors[limbKeypointsId.second]);
+					angle, 0, 360, 1, polygons.back());
+				polygonColors.push_back(colors[limbKeypointsId.second]);
 			}
 		}
-		cv::addWeighted(image, 0.4, pane, 0.6, 0, image);
+		// The limbs are 60% opaque, the rest of the frame isn't touched
+		image.BlendConvexPolys(polygons, polygonColors, 0.6);
 
 
 
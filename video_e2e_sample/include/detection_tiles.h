@@ -0,0 +1,64 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/*
+ * Splits large frames into a grid of overlapping tiles which are detected separately, so
+ * small objects aren't lost when the whole frame is resized to the network input, and
+ * merges the detections of all the tiles.
+ */
+class DetectionTiles
+{
+public:
+    DetectionTiles();
+
+    /* cols x rows tiles, adjacent tiles overlap by overlap times the tile size. 1x1 disables tiling */
+    void Set(int cols, int rows, float overlap);
+    int Count() const { return mCols * mRows; }
+    bool IsEnabled() const { return Count() > 1; }
+
+    /* The tiles of a width x height frame. They all have the same size and start at even
+     * coordinates, as NV12 ROIs do */
+    std::vector<cv::Rect> Split(int width, int height) const;
+
+    /* Greedy non-maximum suppression, returns the indices of the boxes kept by decreasing score.
+     * A box is dropped if its IoU with a kept box is above iouThreshold, or if most of it lies
+     * within a kept box, as the part of an object cut by a tile border does */
+    static std::vector<size_t> NonMaxSuppression(const std::vector<cv::Rect> &boxes,
+        const std::vector<float> &scores, float iouThreshold = 0.5f);
+
+    /* The pixels of an inputSize network input covered by a mosaic tile normalized to the mosaic.
+     * tile is snapped to them, so that the detections are routed by the tile that was filled */
+    static cv::Rect MosaicRect(cv::Rect2f &tile, const cv::Size &inputSize);
+    /* Copies the planar BGR planes of a frame resized to rect into rect of the planes of input */
+    static void CopyToMosaic(const uint8_t *planes, const cv::Rect &rect, uint8_t *input, const cv::Size &inputSize);
+
+    /* Moves a detection of a mosaic, in coordinates normalized to the mosaic, to the coordinates
+     * normalized to its tile. Returns false if the center of the detection is outside the tile */
+    static bool FromMosaic(const cv::Rect2f &tile, float &x0, float &y0, float &x1, float &y1);
+
+private:
+    int mCols;
+    int mRows;
+    float mOverlap;
+};
@@ -16,10 +16,22 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include <inference_engine.hpp>
 #include <opencv2/core/core.hpp>
 
+#include "infer_request_pool.h"
+#include "infer_network_registry.h"
+#include "infer_preprocess.h"
+#include "frame_canvas.h"
+#include "detection_tiles.h"
+#include "infer_input_cache.h"
+
+class InferServer;
+
 
 struct FaceDetectResult {
 	int label;
@@ -44,22 +56,48 @@ class FaceDetect {
 public:
 
 	FaceDetect(bool mEnablePerformanceReport = false);
+	/* If maxBatch > 1, the frames are inferred in batches together with other sessions' frames.
+	 * Otherwise numRequests requests are kept in flight, with more than one Detect() doesn't
+	 * wait for the inference and returns the results of the latest completed frame.
+	 * preprocMode is only used without batching, frameFormat is the format of the frames
+	 * the plugin resizes in InferPreprocess::ModeIE */
 	void Init(const std::string& detectorModelPath,
-		const std::string& targetDeviceName);
-	void Detect(const cv::Mat& image);
+		const std::string& targetDeviceName, int maxBatch = 1, int maxWaitMs = 0, int numRequests = 1,
+		InferPreprocess::Mode preprocMode = InferPreprocess::ModeCPU,
+		InferPreprocess::Format frameFormat = InferPreprocess::FormatRGB4);
+	/* Splits the frames into cols x rows overlapping tiles which are detected separately, as one
+	 * batch, or on parallel requests in InferPreprocess::ModeIE. Call before Init(), the tiled
+	 * detection doesn't use the batches shared with other sessions */
+	void SetTiles(int cols, int rows, float overlap);
+	/* The frames are inferred as the tile part of a mosaic shared with the sessions of the other
+	 * tiles, tile is normalized to the mosaic size. Call before Init(), tiles take precedence */
+	void SetMosaic(const cv::Rect2f& tile);
+	/* Only the detections with a higher confidence are returned, 0.6 by default */
+	void SetThreshold(float threshold);
+	/* The frames are resized through cache, which is shared with the other models of the session */
+	void SetInputCache(InferInputCache* cache);
+	/* With more than one request, region tells apart the parts of the frame detected separately:
+	 * the results are the latest completed ones of the same region */
+	void Detect(const InferPreprocess::Frame& frame, int region = 0);
+	/* Moving average of the time from submitting a frame to its results, 0 if unknown */
+	double LatencyMs() const { return mServer ? 0 : mRequests.LatencyMs(); }
 	void SetSrcImageSize(int width, int height);
-	void RenderFDResults(cv::Mat& image);
+	void RenderFDResults(FrameCanvas& image);
 	~FaceDetect();
 	FDDetectedObjects results;
 
 private:
 
+	static void SetupNetwork(InferenceEngine::CNNNetwork& network);
+	// frameSize is the size of the frame the detections are scaled to
+	void ParseDetections(const float *data, int batchIdx, const cv::Size& frameSize, FDDetectedObjects& objects);
+	void DetectTiles(const InferPreprocess::Frame& frame);
+
 	static std::mutex mInitLock;
 	float mDetectThreshold;
-	InferenceEngine::Core ie;
+	std::shared_ptr<InferNetworkRegistry::Entry> mNetworkEntry;
 	InferenceEngine::CNNNetwork mDetectorNetwork;
-	InferenceEngine::ExecutableNetwork mVDExecutableNetwork;
-	InferenceEngine::InferRequest mDetectorRequest;
+	InferRequestPool mRequests;
 	cv::Size mSrcImageSize;
 	bool mEnablePerformanceReport;
 	std::string input_name_;
@@ -67,8 +105,25 @@ private:
 	int max_detections_count_ = 0;
 	int object_size_ = 0;
 	int enqueued_frames_ = 0;
-	float width_ = 0;
-	float height_ = 0;
 	bool results_fetched_ = false;
+
+	std::shared_ptr<InferServer> mServer;
+	cv::Size mInputSize;
+	InferPreprocess::Mode mPreprocMode = InferPreprocess::ModeCPU;
+	std::vector<uint8_t> mInputPlanes;
+	DetectionTiles mTiles;
+	InferInputCache *mInputCache = nullptr;
+	bool mMosaic = false;
+	cv::Rect2f mMosaicTile;
+	cv::Rect mMosaicRect; // the tile in the network input
+
+	struct LatestResults
+	{
+		unsigned int seq = 0;
+		FDDetectedObjects objects;
+	};
+	std::mutex mResultsLock;
+	std::map<int, LatestResults> mLatestResults; // by region
+	unsigned int mSubmitted = 0;
 	
 };
@@ -28,6 +28,7 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 #define RTSP_ERROR_MAX_COUNT 10
 #define FFMPEG_CONFIGURATION "--enable-static"
 #include <queue>
+#include <deque>
 #include <thread>
 #include <stddef.h>
 
@@ -48,6 +49,7 @@ typedef struct
 {
 	size_t size;
 	void *data;
+	bool key; // key frame
 } PacketData;
 #endif
 
@@ -65,6 +67,11 @@ public:
 	virtual mfxStatus Init(const msdk_char *strFileName);
 	virtual mfxStatus ReadNextFrame(mfxBitstream *pBS);
 
+	// Activity score of the next decoded frame, in decoding order: the coded size of its packet
+	// relative to the running average size of the key frames. Key frames score +infinity, and -1 is
+	// returned when the score is unknown, i.e. for file input or before the first key frame
+	mfxF64 PopFrameActivity();
+
 
 #ifdef RTSP_SUPPORT
 	RTSP_STATUS GetRTSPStatus() { return m_rtsp_status; };
@@ -88,5 +95,10 @@ protected:
 	/* Saving RTSP stream to local file */
 
 	FILE *m_rtsp_file;
+
+	/* Activity scores of the packets read and not decoded yet */
+	void PushFrameActivity(const PacketData *packet);
+	std::deque<mfxF64> m_frame_activity;
+	mfxF64 m_key_frame_size;
 #endif
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+/*
+ * Draws the inference results on a decoded frame in its own format. RGB4 frames are drawn on
+ * directly. NV12 frames are drawn on the luma plane and, at half the scale, on the chroma plane,
+ * so they don't need to be converted to RGB4 for the overlays. The colors are BGR as for cv::Mat.
+ */
+class FrameCanvas
+{
+public:
+    /* A 4 channel image */
+    explicit FrameCanvas(const cv::Mat &rgb4);
+    /* The luma plane and the interleaved chroma plane, 1 and 2 channels */
+    FrameCanvas(const cv::Mat &y, const cv::Mat &uv);
+
+    void Rectangle(const cv::Rect &rect, const cv::Scalar &color, int thickness);
+    void Text(const std::string &text, cv::Point org, int fontFace, double fontScale, const cv::Scalar &color,
+        int thickness = 1, int lineType = cv::LINE_8);
+    void Circle(cv::Point center, int radius, const cv::Scalar &color, int thickness);
+    void FillConvexPoly(const std::vector<cv::Point> &points, const cv::Scalar &color);
+
+    /* Inside each polygon, this = this * (1 - alpha) + its color * alpha. Where polygons overlap, the
+     * color of the last one is blended. Only the pixels around the polygons are read and written */
+    void BlendConvexPolys(const std::vector<std::vector<cv::Point>> &polygons, const std::vector<cv::Scalar> &colors,
+        double alpha);
+
+private:
+    bool IsNV12() const { return !mUV.empty(); }
+    cv::Scalar LumaColor(const cv::Scalar &color) const;
+    cv::Scalar ChromaColor(const cv::Scalar &color) const;
+
+    cv::Mat mImage; // RGB4 image or NV12 luma
+    cv::Mat mUV;
+};
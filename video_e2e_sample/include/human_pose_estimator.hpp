@@ -6,11 +6,21 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
 
 #include <inference_engine.hpp>
 #include <opencv2/core/core.hpp>
 
 #include "human_pose.hpp"
+#include "infer_request_pool.h"
+#include "infer_network_registry.h"
+#include "infer_preprocess.h"
+#include "infer_input_cache.h"
+
+class InferServer;
 
 namespace human_pose_estimation {
 class HumanPoseEstimator {
@@ -19,24 +29,55 @@ public:
 
     HumanPoseEstimator(const std::string& modelPath,
                        const std::string& targetDeviceName,
-                       bool enablePerformanceReport = false);
-    std::vector<HumanPose> estimate(const cv::Mat& image);
+                       bool enablePerformanceReport = false,
+                       int maxBatch = 1,
+                       int maxWaitMs = 0,
+                       int numRequests = 1,
+                       InferPreprocess::Mode preprocMode = InferPreprocess::ModeCPU,
+                       InferPreprocess::Format frameFormat = InferPreprocess::FormatRGB4);
+    std::vector<HumanPose> estimate(const InferPreprocess::Frame& frame);
+    /* The poses in each of the rois of the frame, in frame coordinates. The rois are inferred
+       on parallel requests, or one by one through the batching server, and all of them are
+       completed on return */
+    std::vector<std::vector<HumanPose> > estimateRois(const InferPreprocess::Frame& frame,
+                                                      const std::vector<cv::Rect>& rois);
+    /* Starts compiling the network for frames of imageSize in the background,
+       so the first estimate() with such frames does not wait for the compile */
+    void prepare(const cv::Size& imageSize);
+    /* The frames are resized through cache, which is shared with the other models of the session */
+    void setInputCache(InferInputCache* cache) { inputCache = cache; }
+    /* Moving average of the time from submitting a frame to its poses with the current input shape,
+       0 if unknown */
+    double latencyMs() const { return (shape && !shape->server) ? shape->requests.LatencyMs() : 0; }
     ~HumanPoseEstimator();
 
 private:
-    void preprocess(const cv::Mat& image, uint8_t* buffer) const;
+    /* The network compiled for one input layer size, with its requests or the batching server */
+    struct InputShape {
+        std::shared_ptr<InferNetworkRegistry::Entry> networkEntry;
+        InferRequestPool requests;
+        std::shared_ptr<InferServer> server;
+    };
+
+    std::shared_ptr<InputShape> loadShape(const cv::Size& layerSize) const;
+    void selectShape(const cv::Size& layerSize);
+    cv::Size layerSizeFor(const cv::Size& imageSize) const;
+    cv::Vec4i padFor(const cv::Size& imageSize, const cv::Size& layerSize) const;
+    std::vector<HumanPose> estimateBatched(const InferPreprocess::Frame& frame, InferInputCache* cache);
+    void preprocess(const InferPreprocess::Frame& frame, uint8_t* buffer, InferInputCache* cache) const;
+    std::vector<HumanPose> postprocessRequest(InferenceEngine::InferRequest& request,
+                                              const cv::Size& imageSize, const cv::Vec4i& imagePad) const;
     std::vector<HumanPose> postprocess(
             const float* heatMapsData, const int heatMapOffset, const int nHeatMaps,
             const float* pafsData, const int pafOffset, const int nPafs,
             const int featureMapWidth, const int featureMapHeight,
-            const cv::Size& imageSize) const;
+            const cv::Size& imageSize, const cv::Vec4i& imagePad) const;
     std::vector<HumanPose> extractPoses(const std::vector<cv::Mat>& heatMaps,
                                         const std::vector<cv::Mat>& pafs) const;
-    void resizeFeatureMaps(std::vector<cv::Mat>& featureMaps) const;
     void correctCoordinates(std::vector<HumanPose>& poses,
                             const cv::Size& featureMapsSize,
-                            const cv::Size& imageSize) const;
-    bool inputWidthIsChanged(const cv::Size& imageSize);
+                            const cv::Size& imageSize,
+                            const cv::Vec4i& imagePad) const;
 
     int minJointsNumber;
     int stride;
@@ -48,14 +89,31 @@ private:
     float minSubsetScore;
     cv::Size inputLayerSize;
     int upsampleRatio;
-    InferenceEngine::Core ie;
     std::string targetDeviceName;
-    InferenceEngine::CNNNetwork network;
-    InferenceEngine::ExecutableNetwork executableNetwork;
-    InferenceEngine::InferRequest request;
+    std::map<std::string, std::string> loadConfig;
+    std::string inputBlobName;
     std::string pafsBlobName;
     std::string heatmapsBlobName;
     bool enablePerformanceReport;
     std::string modelPath;
+    int maxBatch;
+    int maxWaitMs;
+    int numRequests;
+    InferPreprocess::Mode preprocMode;
+    InferPreprocess::Format frameFormat;
+    std::mutex posesLock;
+    std::vector<HumanPose> latestPoses;
+    unsigned int submitted = 0;
+    unsigned int completed = 0;
+    std::vector<uint8_t> inputPlanes;
+    std::vector<float> heatMapsCopy;
+    std::vector<float> pafsCopy;
+    InferInputCache* inputCache = nullptr;
+    // The shapes by input layer width, the height is the one of the model
+    std::shared_ptr<InputShape> shape;
+    std::map<int, std::shared_ptr<InputShape>> shapes;
+    // Compiled in the background while the current shape keeps inferring.
+    // Declared last, the destructors wait for the compiles that use the members above
+    std::map<int, std::shared_future<std::shared_ptr<InputShape>>> pendingShapes;
 };
 }  // namespace human_pose_estimation
@@ -0,0 +1,76 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <mutex>
+
+/*
+ * Chooses the decoded frames of a session which are inferred. With a fixed interval, every
+ * interval-th frame is. With a target rate, the interval is adapted while the session runs,
+ * within [minInterval, maxInterval]: it follows the input frame rate divided by the target
+ * rate, and is raised whenever the inference can't keep up, i.e. one inference takes longer
+ * than the frames between two inferences last, or the frames queued for inference pile up.
+ * It goes back down one step per inference once the inference keeps up again.
+ * With an activity threshold, a frame due for inference is skipped while the bitstream activity
+ * summed over the frames since the last inferred one stays below the threshold.
+ */
+class InferCadence
+{
+public:
+    InferCadence();
+
+    /* targetRate is the number of inferred frames per second, 0 keeps interval fixed. inputFps is the
+     * frame rate of the stream. Bounds of 0 default to 1 and to the larger of interval and 30 */
+    void Init(int interval, int minInterval, int maxInterval, double targetRate, double inputFps);
+
+    /* 0 disables the activity gating */
+    void SetActivityThreshold(double threshold);
+
+    /* Called for each decoded frame in decoding order, returns whether it is inferred. activity is the
+     * coded size score of the frame, a negative one is unknown and counts as enough activity */
+    bool NextFrame(double activity = -1);
+    /* Reports how long the inference of an inferred frame took, from any thread */
+    void InferenceDone(double ms);
+    /* Reports how many frames wait for inference out of capacity, when inference runs in its own thread */
+    void SetBacklog(size_t queued, size_t capacity);
+
+    bool IsAdaptive() const { return mTargetRate > 0; }
+    int Interval() const;
+    unsigned int InferredFrames() const;
+    unsigned int Frames() const;
+    /* Frames due for inference which were skipped for low activity */
+    unsigned int InactiveFrames() const;
+
+private:
+    void Adapt();
+
+    mutable std::mutex mLock;
+    int mInterval;
+    int mMinInterval;
+    int mMaxInterval;
+    double mTargetRate;
+    double mInputFps;
+    double mLatencyMs;     // moving average of the inference time
+    bool mSaturated;       // the queue of frames waiting for inference is full
+    int mSinceInferred;
+    unsigned int mFrames;
+    unsigned int mInferred;
+    double mActivityThreshold;
+    double mActivity;      // sum of the activity since the last inferred frame
+    bool mActivityUnknown; // one of those frames had no activity score
+    unsigned int mInactive;
+};
@@ -0,0 +1,39 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <inference_engine.hpp>
+
+#include "infer_preprocess.h"
+
+/*
+ * Inference on the decoded frames without copying them: the frame pixels are wrapped in an
+ * NHWC blob with the pitch of the surface as row stride (an NV12Blob of two such blobs for NV12),
+ * and the plugin resizes the frame and converts its colors while it infers. Used by the
+ * InferPreprocess::ModeIE sessions.
+ */
+class InferFrameBlob
+{
+public:
+    /* Sets up the network input to take Wrap() blobs of frames in the given format. Call it before
+     * the network is loaded */
+    static void SetupInput(const InferenceEngine::InputInfo::Ptr &input, InferPreprocess::Format format);
+    /* Tells apart the networks set up for the format in InferNetworkRegistry */
+    static std::string NetworkTag(InferPreprocess::Format format);
+    /* The frame must stay unchanged until the inference on the blob completes */
+    static InferenceEngine::Blob::Ptr Wrap(const InferPreprocess::Frame &frame);
+};
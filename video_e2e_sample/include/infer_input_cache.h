@@ -0,0 +1,64 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "infer_preprocess.h"
+
+/*
+ * The planar BGR inputs of one frame at the sizes of the networks inferring it. The models
+ * of a session ask for their input size, each size is resized from the frame once by the
+ * first model asking for it and copied for the others, also when they run concurrently.
+ * Frames other than the one given to Reset(), e.g. a region or a tile of it, are resized
+ * as usual.
+ */
+class InferInputCache
+{
+public:
+    InferInputCache();
+
+    /* The inputs of frame are resized from now on, the buffers of the last frame are reused */
+    void Reset(const InferPreprocess::Frame &frame);
+
+    /* Same as InferPreprocess::ResizeToPlanarBGR(), with the resized planes of src taken from
+     * cache when src is its frame. cache may be null */
+    static void ResizeToPlanarBGR(InferInputCache *cache, const InferPreprocess::Frame &src, uint8_t *dst,
+        int dstWidth, int dstHeight, size_t dstStride, size_t planeStride);
+
+private:
+    struct Entry
+    {
+        std::mutex lock;
+        bool ready = false;
+        std::vector<uint8_t> planes;
+    };
+
+    bool IsFrame(const InferPreprocess::Frame &frame) const;
+    /* The planes of the frame resized to width x height, resized on the first call */
+    const uint8_t *Planes(int width, int height);
+
+    std::mutex mLock;
+    InferPreprocess::Frame mFrame;
+    std::map<std::pair<int, int>, std::unique_ptr<Entry>> mEntries;
+};
@@ -0,0 +1,157 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+
+#include "infer_preprocess.h"
+#include "infer_input_cache.h"
+#include "frame_canvas.h"
+#include "face_detect.hpp"
+#include "vehicle_detect.hpp"
+#include "human_pose_estimator.hpp"
+
+/*
+ * One model run by MediaInferenceManager on the inferred frames of a session. It keeps the
+ * results of the last inferred frame, renders them, and gives their boxes to the tracker and
+ * takes them back moved. A new kind of model implements this interface and is added to the
+ * manager in Init(), the per-frame code of the manager doesn't change.
+ */
+class InferModel
+{
+public:
+    virtual ~InferModel() {}
+
+    /* Infers frame, only the regions of it if the model supports them */
+    virtual void Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions) = 0;
+    virtual void Render(FrameCanvas &canvas) const = 0;
+    virtual void Clear() = 0;
+    /* Appends the box of each result */
+    virtual void GetBoxes(std::vector<cv::Rect2f> &boxes) const = 0;
+    /* The results whose boxes were from[i] move to to[i], for the first count results at most.
+     * Returns how many results there are, i.e. how many boxes the model used */
+    virtual size_t MoveBoxes(const cv::Rect2f *from, const cv::Rect2f *to, size_t count) = 0;
+    /* The frames are resized through cache, shared with the other models of the session */
+    virtual void SetInputCache(InferInputCache *cache) = 0;
+    /* Moving average of the time from submitting a frame to its results, which Infer() doesn't wait
+     * for with several requests in flight. 0 if the model doesn't measure it */
+    virtual double LatencyMs() const = 0;
+};
+
+/*
+ * Infers the frames given to Start() with model in its own thread, which lives as long as the
+ * worker. Start() returns at once, Wait() blocks until the frame is inferred and rethrows what
+ * Infer() threw. The frame and the regions must stay valid until then.
+ */
+class InferModelWorker
+{
+public:
+    explicit InferModelWorker(InferModel *model);
+    ~InferModelWorker();
+
+    void Start(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions);
+    void Wait();
+
+private:
+    InferModelWorker(const InferModelWorker &);
+    InferModelWorker &operator=(const InferModelWorker &);
+
+    void Run();
+
+    InferModel *mModel;
+    const InferPreprocess::Frame *mFrame;
+    const std::vector<cv::Rect> *mRegions;
+    bool mBusy;
+    bool mStop;
+    std::exception_ptr mError;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::thread mThread; // last, it starts with the other members set
+};
+
+class FaceDetectModel : public InferModel
+{
+public:
+    explicit FaceDetectModel(FaceDetect *detector) : mDetector(detector) {}
+
+    void Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions) override;
+    void Render(FrameCanvas &canvas) const override;
+    void Clear() override { mDetector->results.clear(); }
+    void GetBoxes(std::vector<cv::Rect2f> &boxes) const override;
+    size_t MoveBoxes(const cv::Rect2f *from, const cv::Rect2f *to, size_t count) override;
+    void SetInputCache(InferInputCache *cache) override { mDetector->SetInputCache(cache); }
+    double LatencyMs() const override { return mDetector->LatencyMs(); }
+
+private:
+    std::unique_ptr<FaceDetect> mDetector;
+};
+
+class VehicleDetectModel : public InferModel
+{
+public:
+    /* At most maxObjNum vehicles per frame are classified, -1 for all of them */
+    VehicleDetectModel(VehicleDetect *detector, int maxObjNum) : mDetector(detector), mMaxObjNum(maxObjNum) {}
+
+    void Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions) override;
+    void Render(FrameCanvas &canvas) const override;
+    void Clear() override { mResults.clear(); }
+    void GetBoxes(std::vector<cv::Rect2f> &boxes) const override;
+    size_t MoveBoxes(const cv::Rect2f *from, const cv::Rect2f *to, size_t count) override;
+    void SetInputCache(InferInputCache *cache) override { mDetector->SetInputCache(cache); }
+    double LatencyMs() const override { return mDetector->LatencyMs(); }
+
+private:
+    std::unique_ptr<VehicleDetect> mDetector;
+    int mMaxObjNum;
+    std::vector<VehicleDetectResult> mResults;
+};
+
+/* Infers the whole frame, the regions are ignored. With fullFrameInterval > 0, the next frames are
+ * inferred on square crops around the people of the last poses, as long as the crops are few and
+ * small. The whole frame is inferred again every fullFrameInterval inferred frames, or as soon as
+ * a person isn't found in its crop */
+class HumanPoseModel : public InferModel
+{
+public:
+    explicit HumanPoseModel(human_pose_estimation::HumanPoseEstimator *estimator, int fullFrameInterval = 0)
+        : mEstimator(estimator), mFullFrameInterval(fullFrameInterval), mCropFrames(0) {}
+
+    void Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions) override;
+    void Render(FrameCanvas &canvas) const override;
+    void Clear() override { mPoses.clear(); }
+    void GetBoxes(std::vector<cv::Rect2f> &boxes) const override;
+    size_t MoveBoxes(const cv::Rect2f *from, const cv::Rect2f *to, size_t count) override;
+    void SetInputCache(InferInputCache *cache) override { mEstimator->setInputCache(cache); }
+    double LatencyMs() const override { return mEstimator->latencyMs(); }
+
+private:
+    /* Returns false if the whole frame has to be inferred instead */
+    bool InferCrops(const InferPreprocess::Frame &frame);
+
+    std::unique_ptr<human_pose_estimation::HumanPoseEstimator> mEstimator;
+    std::vector<human_pose_estimation::HumanPose> mPoses;
+    int mFullFrameInterval;
+    int mCropFrames; // inferred on crops since the whole frame was
+};
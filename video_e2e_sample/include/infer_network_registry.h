@@ -0,0 +1,83 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <future>
+
+#include <inference_engine.hpp>
+
+/*
+ * All the sessions of the process share one InferenceEngine::Core, and one network and
+ * ExecutableNetwork per model, device and configuration. Sessions only create their own
+ * InferRequests, so an IR used by many sessions is read and compiled once and its weights
+ * are resident once. A network is released when the last session using it is destroyed.
+ * Independent networks load in parallel. If a cache directory is set, compiled networks are
+ * exported there and imported by the next runs, on the plugins which support it.
+ */
+class InferNetworkRegistry
+{
+public:
+    /* Prepares the network before it's loaded, e.g. sets precisions, reshapes or sets the batch size */
+    typedef std::function<void(InferenceEngine::CNNNetwork &network)> NetworkSetup;
+
+    struct Entry
+    {
+        InferenceEngine::CNNNetwork network;
+        InferenceEngine::ExecutableNetwork executableNetwork;
+        std::string cacheFile;
+    };
+
+    static InferenceEngine::Core &GetCore();
+
+    /* Directory of the compiled networks cache, empty disables the cache. Call before Load() */
+    static void SetCacheDir(const std::string &dir);
+
+    /* Returns the network as read from modelPath, shared by all the callers. Only use it to inspect the
+     * network, e.g. its inputs and outputs, use Load() for the networks to infer with */
+    static std::shared_ptr<const InferenceEngine::CNNNetwork> ReadNetwork(const std::string &modelPath);
+
+    /*
+     * Returns the network modelPath loaded on device, reading and loading it on first use.
+     * setupTag must identify what setup does to the network, networks of the same file
+     * with different setups are different entries. Throws if the network can't be loaded.
+     */
+    static std::shared_ptr<Entry> Load(const std::string &modelPath, const std::string &device,
+        const std::string &setupTag, const NetworkSetup &setup,
+        const std::map<std::string, std::string> &config = std::map<std::string, std::string>());
+
+private:
+    struct Slot
+    {
+        std::weak_ptr<Entry> entry;
+        std::shared_future<std::shared_ptr<Entry>> loading; // valid while the entry is being loaded
+    };
+
+    static bool ImportCached(Entry &entry, const std::string &modelPath, const std::string &device,
+        const std::string &key, const std::string &cacheDir, const std::map<std::string, std::string> &config);
+    static void ExportCached(Entry &entry, const std::string &cacheDir);
+
+    static std::mutex sLock;
+    static std::map<std::string, Slot> sEntries;
+    static std::mutex sReadLock;
+    static std::map<std::string, std::weak_ptr<const InferenceEngine::CNNNetwork>> sReadNetworks;
+    static std::string sCacheDir;
+};
@@ -0,0 +1,68 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Preprocessing of the decoded frames into the U8 NCHW input blobs. One pass reads the
+ * frame, resizes it bilinearly and writes the color planes, instead of converting the
+ * whole frame to BGR, resizing it and splitting it into planes.
+ */
+class InferPreprocess
+{
+public:
+    enum Format { FormatRGB4, FormatNV12 };
+
+    /* A frame in system memory. RGB4 frames have 4 bytes per pixel at data. NV12 frames have the
+     * luma at data and the interleaved half-resolution chroma at uv, both with the same pitch */
+    struct Frame
+    {
+        const uint8_t *data;
+        int width;
+        int height;
+        int pitch;
+        Format format;
+        const uint8_t *uv;
+
+        /* The ROI of an NV12 frame starts at even coordinates, x and y are rounded down */
+        Frame Roi(int x, int y, int w, int h) const;
+    };
+
+    /* Copies the pixels of src to storage and returns the copy */
+    static Frame Copy(const Frame &src, std::vector<uint8_t> &storage);
+
+    /* Where the frames are resized and converted: by ResizeToPlanarBGR() on the CPU, or by the
+     * inference plugin on the frame wrapped as it is, see InferFrameBlob */
+    enum Mode { ModeCPU, ModeIE };
+
+    enum Isa { IsaScalar, IsaAVX2, IsaAVX512 };
+
+    /* Resizes src to dstWidth x dstHeight and writes it as planar BGR. Row y of plane c starts at
+     * dst + c * planeStride + y * dstStride. The color conversion of RGB4 is the same as COLOR_RGBA2BGR,
+     * NV12 (BT.601, limited range) gives the same planes as its conversion to RGB4 would */
+    static void ResizeToPlanarBGR(const Frame &src, uint8_t *dst, int dstWidth, int dstHeight,
+        size_t dstStride, size_t planeStride);
+    /* Same with the given instruction set, which must not be better than SupportedIsa() */
+    static void ResizeToPlanarBGR(Isa isa, const Frame &src, uint8_t *dst, int dstWidth, int dstHeight,
+        size_t dstStride, size_t planeStride);
+
+    /* The best instruction set supported by both the CPU and the OS */
+    static Isa SupportedIsa();
+};
@@ -0,0 +1,83 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include <inference_engine.hpp>
+
+/*
+ * A fixed set of InferRequests created from one ExecutableNetwork. The caller fills the
+ * input of a free request and starts it with StartAsync(); the completion handler is
+ * called from the plugin's callback thread and the request becomes free again when it
+ * returns. While the device works on one request, the next input can be prepared.
+ */
+class InferRequestPool
+{
+public:
+    /* slot is the index of the request in the pool, in [0, Depth()) */
+    typedef std::function<void(InferenceEngine::InferRequest &request, size_t slot)> CompletionHandler;
+
+    InferRequestPool();
+    ~InferRequestPool();
+
+    void Init(InferenceEngine::ExecutableNetwork &network, int depth);
+    int Depth() const { return (int)mSlots.size(); }
+
+    /* Blocks until one of the requests is free and returns its slot */
+    size_t Acquire();
+    InferenceEngine::InferRequest &Request(size_t slot) { return mSlots[slot].request; }
+    /* Starts the acquired request. done isn't called if the inference fails */
+    void StartAsync(size_t slot, const CompletionHandler &done);
+    /* Blocks until all the started requests are completed */
+    void WaitAll();
+    /* Called from the completion handler of slot, keeps it busy after the handler returns, e.g. while
+     * a request chained to it runs. Release() frees it, WaitAll() waits for it until then */
+    void Hold(size_t slot);
+    void Release(size_t slot);
+    /* Moving average of the time from StartAsync() until the slot is free again, 0 before the
+     * first request is done. Unlike the time StartAsync() takes, it grows when the device is late */
+    double LatencyMs() const { return mLatencyMs; }
+
+private:
+    struct Slot
+    {
+        InferenceEngine::InferRequest request;
+        CompletionHandler done;
+        bool busy;
+        bool held;
+        bool handling; // the completion handler runs, a Release() from it frees the slot when it returns
+        std::chrono::steady_clock::time_point started;
+    };
+
+    InferRequestPool(const InferRequestPool &);
+    InferRequestPool &operator=(const InferRequestPool &);
+
+    void OnComplete(size_t slot, InferenceEngine::StatusCode status);
+    /* Called under mLock when slot becomes free */
+    void Done(Slot &slot);
+
+    std::vector<Slot> mSlots;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::atomic<double> mLatencyMs;
+};
@@ -0,0 +1,110 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
+
+#include <inference_engine.hpp>
+
+#include "infer_network_registry.h"
+
+/*
+ * InferServer is shared by all the sessions which run the same model on the same device.
+ * Sessions submit one frame at a time, the server thread packs the pending frames into
+ * one batch of up to maxBatch frames and runs a single inference for all of them. A batch
+ * is started as soon as it is full, every attached session has a frame pending, or the
+ * oldest frame has waited for maxWaitMs.
+ * A mosaic server infers a batch of 1: the frames of up to maxBatch sessions are all filled
+ * into slot 0, each session into its own part of the input, and each session picks its
+ * results out of the one inference.
+ */
+class InferServer
+{
+public:
+    /* Called once before the network is loaded, e.g. to set input/output precision */
+    typedef InferNetworkRegistry::NetworkSetup NetworkSetup;
+    /* Copies the frame into slot batchIdx of the input blob. Runs in the server thread */
+    typedef std::function<void(InferenceEngine::Blob::Ptr &input, size_t batchIdx)> InputFiller;
+    /* Parses the results of slot batchIdx. Runs in the server thread */
+    typedef std::function<void(InferenceEngine::InferRequest &request, size_t batchIdx)> ResultHandler;
+
+    /*
+     * Returns the server for modelPath on device, creating and loading it on first use.
+     * tag distinguishes networks of the same file which are set up differently (e.g. reshaped).
+     * The returned handle counts as one attached session until it is released.
+     */
+    static std::shared_ptr<InferServer> Get(const std::string &modelPath, const std::string &device,
+        const std::string &tag, int maxBatch, int maxWaitMs, const NetworkSetup &setup, bool mosaic = false);
+
+    /* The most sessions sharing one mosaic */
+    static const int MosaicMaxTiles = 64;
+
+    ~InferServer();
+
+    /* Queues one frame and blocks until the batch it belongs to is inferred and handled */
+    void Infer(const InputFiller &fill, const ResultHandler &handle);
+
+    const InferenceEngine::CNNNetwork &Network() const { return mNetwork->network; }
+    const std::string &InputName() const { return mInputName; }
+    int MaxBatch() const { return mMaxBatch; }
+
+private:
+    struct Job
+    {
+        InputFiller fill;
+        ResultHandler handle;
+        std::promise<void> done;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    InferServer(const std::string &tag, int maxBatch, int maxWaitMs, bool mosaic);
+    InferServer(const InferServer &);
+    InferServer &operator=(const InferServer &);
+
+    void Load(const std::string &modelPath, const std::string &device, const NetworkSetup &setup);
+    void Detach();
+    void Run();
+    void RunBatch(std::vector<std::shared_ptr<Job>> &batch);
+
+    std::shared_ptr<InferNetworkRegistry::Entry> mNetwork;
+    InferenceEngine::InferRequest mRequest;
+    std::string mTag;
+    std::string mInputName;
+    int mMaxBatch;
+    std::chrono::milliseconds mMaxWait;
+    bool mDynBatch; // the plugin accepts SetBatch(), so partial batches don't cost a full batch
+    bool mMosaic;
+
+    std::thread mThread;
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::vector<std::shared_ptr<Job>> mPending;
+    int mClients;
+    bool mStop;
+
+    static std::mutex sServersLock;
+    static std::map<std::string, std::weak_ptr<InferServer>> sServers;
+};
@@ -23,7 +23,12 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 #include "vehicle_detect.hpp"
 #include "face_detect.hpp"
 #include "human_pose_estimator.hpp"
+#include "object_tracker.h"
+#include "motion_gate.h"
+#include "infer_input_cache.h"
+#include "infer_model.h"
 #include <opencv2/imgproc/imgproc.hpp>
+#include <atomic>
 
 using namespace human_pose_estimation;
 
@@ -35,9 +40,65 @@ public:
     ~MediaInferenceManager();
     enum InferDeviceType {InferDeviceGPU, InferDeviceCPU, InferDeviceHDDL };
     int Init(int dec_w, int dec_h, int infer_type, msdk_char *model_dir, enum InferDeviceType device, int maxObjNum);
-    /* If inferOffline is true, the results won't be render to input surface */
-    int RunInfer(mfxFrameData *data, bool inferOffline);
-    int RenderRepeatLast(mfxFrameData *data);
+    /* If maxBatch > 1, the frames of all the sessions running the same model are inferred in batches
+     * of up to maxBatch frames. A frame waits at most maxWaitMs for the batch to fill. Call before Init() */
+    void SetBatchMode(int maxBatch, int maxWaitMs);
+    /* Number of in-flight inference requests of each model. With more than one, RunInfer() doesn't wait
+     * for the inference and renders the results of the latest completed frame. Call before Init() */
+    void SetRequestNum(int num);
+    /* Compiled networks are stored in dir and imported on the next run instead of being compiled again.
+     * Applies to all the instances, call before Init() */
+    static void SetNetworkCacheDir(const msdk_char *dir);
+    /* Whether the frames are resized on the CPU or by the inference plugin. Call before Init() */
+    void SetPreprocessMode(InferPreprocess::Mode mode);
+    /* Format of the surfaces passed to RunInfer(), RGB4 or NV12. Call before Init() */
+    void SetFrameFormat(InferPreprocess::Format format);
+    /* If enabled, the results rendered by RenderRepeatLast() are moved to where a tracker predicts
+     * the objects in that frame, instead of being drawn where they were last inferred */
+    void SetTracking(bool enable);
+    /* Frames whose luma differs from the last inferred frame by less than threshold levels on average
+     * aren't inferred, the last results are rendered instead. 0 infers all the frames */
+    void SetMotionThreshold(float threshold);
+    /* Face and vehicle detection only infer these regions of the decoded frame, each one on its own,
+     * and render the results in frame coordinates. Empty infers the whole frame. Call before Init() */
+    void SetRois(const std::vector<cv::Rect> &rois);
+    /* Face and vehicle detection split the frame (or each region) into cols x rows tiles, adjacent
+     * tiles overlap by overlap times the tile size. Call before Init() */
+    void SetTiles(int cols, int rows, float overlap);
+    /* Face and vehicle detection infer the frame as the tile part of a mosaicSize mosaic, one detector
+     * run serves all the sessions sharing the model. Tiles take precedence. Call before Init() */
+    void SetMosaic(const cv::Rect &tile, const cv::Size &mosaicSize);
+    /* The models of these infer types run on the frames given to RunInfer() too, concurrently with the
+     * model of the infer type of Init(). A frame is resized once for each input size. Call before Init() */
+    void SetExtraInferTypes(const std::vector<int> &types);
+    /* Cascade: the SSD detector modelPath runs on every frame given to RunInfer(), and the model of the
+     * infer type only runs when it detects something with a confidence above threshold. Otherwise the
+     * frame has no results. Empty modelPath runs the model of the infer type on all the frames.
+     * Call before Init() */
+    void SetCascade(const msdk_char *modelPath, float threshold);
+    /* Human pose estimation infers square crops around the people it found instead of the whole
+     * frame, while they are few and small. The whole frame is inferred every fullFrameInterval
+     * inferred frames, or when a person isn't found in its crop. 0 always infers the whole frame.
+     * Call before Init() */
+    void SetHumanPoseCrops(int fullFrameInterval);
+    struct CascadeStatistics
+    {
+        mfxU32 frames;    // frames the cheap tier ran on
+        mfxU32 escalated; // of them, frames the model of the infer type ran on
+        double cheapMs;   // average time of the cheap tier per frame
+        double fullMs;    // average time of the model of the infer type per escalated frame
+    };
+    bool IsCascade() const { return mCascadeDetector != nullptr; }
+    CascadeStatistics GetCascadeStatistics() const;
+    /* Number of frames RunInfer() skipped because they didn't change */
+    mfxU32 MotionSkippedFrames() const { return mMotionSkipped; }
+    /* The longest time from submitting a frame to its results among the models, measured on the
+     * requests. RunInfer() returns before that with several requests in flight. 0 if unknown */
+    double InferLatencyMs() const;
+    /* If inferOffline is true, the results won't be render to input surface.
+     * Returns 1 if the motion gate skipped the frame */
+    int RunInfer(mfxFrameSurface1 *surface, bool inferOffline);
+    int RenderRepeatLast(mfxFrameSurface1 *surface);
 
     const static int InferTypeNone = 0;
     const static int InferTypeFaceDetection = 1;
@@ -45,24 +106,38 @@ public:
     const static int InferTypeVADetect = 3;
 
 private:
+    /* Each one adds its model to mModels */
     int InitFaceDetection(msdk_char *model_dir);
-    int RunInferFD(mfxFrameData *pData, bool inferOffline);
-    int RenderRepeatLastFD(mfxFrameData *pData);
-
     int InitVehicleDetect(msdk_char *model_dir);
-    int RunInferVDVA(mfxFrameData *pData, bool inferOffline);
-    int RenderRepeatLastVD(mfxFrameData *pData);
-
     int InitHumanPose(msdk_char *model_dir);
-    int RunInferHP(mfxFrameData *pData, bool inferOffline);
-    int RenderRepeatLastHP(mfxFrameData *pData);
+
+    bool HasInferType(int type) const;
+
+    /* The decoded surface as the input of the inference and as the image to render on */
+    InferPreprocess::Frame SurfaceFrame(mfxFrameData *pData);
+    FrameCanvas SurfaceCanvas(mfxFrameData *pData);
+    /* The regions set by SetRois() within the decoded frame, or the whole frame */
+    std::vector<cv::Rect> InferRegions() const;
+    /* Whether the cheap tier of the cascade detects something in the inferred regions of frame */
+    bool CascadeEscalates(const InferPreprocess::Frame &frame);
+    /* Drops the results of the last inferred frame */
+    void ClearResults();
+
+    /* The tracks restart from the results of the inferred frame */
+    void CorrectTracks();
+    /* Moves the last results by one frame */
+    void PredictTracks();
 
     void raw_dumper_nv12(const char *name, int w, int h, int pitch, unsigned char *y, unsigned char *uv);
     void pitch_nv12_to_buffer(unsigned char *out, int w, int h, int pitch, unsigned char *y, unsigned char *uv);
     void  raw_dumper_rgb(const char *name, int w, int h, int ch, unsigned char *data);
     int mInferType;
+    std::vector<int> mExtraInferTypes;
+    std::vector<int> mInferTypes; // mInferType first
     int mDecW;
     int mDecH;
+    int mCropX;
+    int mCropY;
     int mInputW;
     int mInputH;
     int mBatchId;
@@ -71,16 +146,36 @@ private:
 
     int mInferInterval;
     int mInferDevType;
+    int mMaxBatch;
+    int mMaxBatchWaitMs;
+    int mRequestNum;
+    InferPreprocess::Mode mPreprocMode;
+    InferPreprocess::Format mFrameFormat;
     bool mInit;
-
-    FaceDetect *mFaceDetector = nullptr;
-
-    /*Vehicle and Vehicle attributes detection*/
-    VehicleDetect *mVehicleDetector = nullptr;
-    std::vector<VehicleDetectResult> mVDResults;
-
-    /*Human Pose Estimation*/
-    HumanPoseEstimator *mHPEstimator = nullptr;
-    std::vector<HumanPose> mPoses;
+    bool mTracking;
+    ObjectTracker mTracker;
+    MotionGate mMotionGate;
+    std::vector<cv::Rect> mRois;
+    int mTileCols;
+    int mTileRows;
+    float mTileOverlap;
+    bool mMosaic;
+    cv::Rect2f mMosaicTile;
+    bool mShareInputs;
+    InferInputCache mInputCache;
+    std::atomic<mfxU32> mMotionSkipped;
+    std::string mCascadeModel;
+    float mCascadeThreshold;
+    std::atomic<mfxU32> mCascadeFrames;
+    std::atomic<mfxU32> mCascadeEscalated;
+    std::atomic<mfxU64> mCascadeUs; // total time of each tier
+    std::atomic<mfxU64> mFullUs;
+    int mPoseFullFrameInterval;
+
+    /* The models of mInferTypes, in the same order */
+    std::vector<std::unique_ptr<InferModel>> mModels;
+    /* The threads of mModels[1...], declared after them to stop first */
+    std::vector<std::unique_ptr<InferModelWorker>> mModelWorkers;
+    FaceDetect *mCascadeDetector = nullptr;
 };
 
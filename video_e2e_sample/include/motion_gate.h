@@ -0,0 +1,54 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "infer_preprocess.h"
+
+/*
+ * Tells whether a frame changed enough since the last inferred frame to be worth inferring.
+ * The frame is reduced to a GRID_WIDTH x GRID_HEIGHT thumbnail of its luma (the average of
+ * the color channels for RGB4), reading every ROW_STEP-th row only, and compared with the
+ * thumbnail of the last inferred frame by the mean absolute difference of the cells.
+ */
+class MotionGate
+{
+public:
+    MotionGate();
+
+    /* Mean absolute difference in luma levels below which a frame counts as unchanged, 0 disables the gate */
+    void SetThreshold(float threshold) { mThreshold = threshold; }
+    bool IsEnabled() const { return mThreshold > 0; }
+
+    /* Returns whether frame differs from the last frame that was reported as changed. That frame
+     * becomes the reference, so slow changes add up until they pass the threshold */
+    bool Changed(const InferPreprocess::Frame &frame);
+
+private:
+    static const int GRID_WIDTH = 32;
+    static const int GRID_HEIGHT = 18;
+    static const int ROW_STEP = 4;
+
+    void Thumbnail(const InferPreprocess::Frame &frame, uint8_t *cells) const;
+
+    float mThreshold;
+    bool mHasReference;
+    std::vector<uint8_t> mReference;
+    std::vector<uint8_t> mCurrent;
+};
@@ -0,0 +1,60 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+/*
+ * Moves the inference results over the frames which aren't inferred. Each detected box is a
+ * track with a constant-velocity motion model: on an inferred frame the boxes are associated
+ * with the tracks by IoU and the velocities are corrected from the distance the boxes moved
+ * (an alpha-beta filter), on the other frames the tracks move by their velocity.
+ */
+class ObjectTracker
+{
+public:
+    ObjectTracker();
+
+    /* An inferred frame: boxes become the tracks, track i is boxes[i] */
+    void Correct(const std::vector<cv::Rect2f> &boxes);
+    /* A frame which isn't inferred: moves the tracks by one frame */
+    void Predict();
+
+    size_t Size() const { return mTracks.size(); }
+    /* The estimated box of track i in the current frame */
+    cv::Rect2f Box(size_t i) const;
+    void Clear();
+
+private:
+    struct Track
+    {
+        cv::Point2f center;
+        cv::Size2f size;
+        cv::Point2f velocity; // per frame
+        cv::Size2f growth;    // per frame
+    };
+
+    static float IoU(const cv::Rect2f &a, const cv::Rect2f &b);
+
+    std::vector<Track> mTracks;
+    int mFramesSinceCorrect;
+    float mMinIoU;    // boxes overlapping a track less than this are new objects
+    float mGain;      // weight of the measured velocity in the corrected velocity
+    float mMaxGrowth; // the size change per frame is limited to this ratio of the size
+};
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
@@ -22,9 +23,12 @@ struct Peak {
 };
 
 struct HumanPoseByPeaksIndices {
+    static const int maxKeypointsNumber = 18;
+
     explicit HumanPoseByPeaksIndices(const int keypointsNumber);
 
-    std::vector<int> peaksIndices;
+    // -1 past keypointsNumber
+    std::array<int, maxKeypointsNumber> peaksIndices;
     int nJoints;
     float score;
 };
@@ -39,7 +43,34 @@ struct TwoJointsConnection {
     float score;
 };
 
+// Reads a feature map as resized upsampleRatio times by cv::resize() with cv::INTER_CUBIC,
+// only at the pixels asked for
+class UpsampledFeatureMap {
+public:
+    static const int maxUpsampleRatio = 8;
+
+    UpsampledFeatureMap(const cv::Mat& featureMap, const int upsampleRatio);
+
+    float at(const int x, const int y) const;
+    int cols() const { return featureMap.cols * upsampleRatio; }
+    int rows() const { return featureMap.rows * upsampleRatio; }
+
+private:
+    cv::Mat featureMap;
+    int upsampleRatio;
+    // For each phase of the upsampled pixel, the first of the four source pixels
+    // relative to the pixel divided by the ratio, and the four coefficients
+    int firstTap[maxUpsampleRatio];
+    float coeffs[4 * maxUpsampleRatio];
+};
+
+// The peaks are in the pixels of the heatmaps upsampled upsampleRatio times. With a ratio above 1
+// they are searched around the maxima of the heatmaps as they are, without upsampling the whole
+// maps. They are the peaks of the upsampled maps, at the same pixels with the same scores, except
+// for the maxima that the ringing of the cubic kernel adds away from the maxima of the maps.
+// These are rare on heatmaps, benchmark/peaks_benchmark.cpp prints the differences.
 void findPeaks(const std::vector<cv::Mat>& heatMaps,
+               const int upsampleRatio,
                const float minPeaksDistance,
                std::vector<std::vector<Peak> >& allPeaks,
                int heatMapId);
@@ -47,6 +78,7 @@ void findPeaks(const std::vector<cv::Mat>& heatMaps,
 std::vector<HumanPose> groupPeaksToPoses(
         const std::vector<std::vector<Peak> >& allPeaks,
         const std::vector<cv::Mat>& pafs,
+        const int upsampleRatio,
         const size_t keypointsNumber,
         const float midPointsScoreThreshold,
         const float foundMidPointsRatioThreshold,
@@ -25,6 +25,7 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 #include "mfxplugin.h"
 #include "mfxplugin++.h"
 #include "media_inference_manager.h"
+#include "infer_cadence.h"
 #include "file_and_rtsp_bitstream_reader.h"
 #include <memory>
 #include <vector>
@@ -34,6 +35,9 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 #include <future>
 #include <chrono>
 #include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
 
 #include "sample_defs.h"
 #include "sample_utils.h"
@@ -207,11 +211,34 @@ namespace TranscodingSample
 
 #if OVINO
         int InferType; //if > 0, will run inference after decoding
+        std::vector<int> InferExtraTypes; // The other models run on the frames inferred by InferType
         bool InferOffline; // Default false. If true, the results won't be rendered
+        bool InferTracking; // Default false. If true, the results move with the objects on the frames which aren't inferred
         MediaInferenceManager::InferDeviceType InferDevType; //Target inference device
         int InferMaxObjNum; // The maximum number of detected objects for classification
+        std::vector<cv::Rect> InferRois; // Regions of the decoded frame to infer, the whole frame if empty
+        int InferTileCols; // If more than 1x1, detection runs on a grid of overlapping tiles of the frame
+        int InferTileRows;
+        mfxF64 InferTileOverlap; // Overlap of adjacent tiles, relative to the tile size
+        bool InferMosaic; // Default false. If true, detection runs on a mosaic shared with the other mosaic sessions
+        mfxU16 InferMosaicW; // Extent of the -vpp_comp_dst_* rects of the mosaic sessions, set by the launcher
+        mfxU16 InferMosaicH;
         int InferInterval; //The distance of two inferenced frames
+        int InferIntervalMin; // Bounds of the interval when it's adapted to InferRate, 0 for the defaults
+        int InferIntervalMax;
+        mfxF64 InferRate; // If > 0, the interval is adapted at runtime to infer this many frames per second
+        mfxF64 InferActivityThreshold; // If > 0, scheduled frames aren't inferred until the bitstream activity since the last inferred frame reaches this
+        mfxF64 InferMotionThreshold; // If > 0, frames whose luma changed less than this since the last inferred frame aren't inferred
+        int InferAsyncDepth; // If > 0, inference runs in a separate thread fed by a queue of this many surfaces
+        int InferBatch; // If > 1, frames of all the sessions running the same model are inferred in batches of up to this size
+        int InferBatchTimeout; // The maximum time in ms a frame waits for its batch to fill
+        int InferRequests; // Number of in-flight inference requests per session
+        InferPreprocess::Mode InferPreprocMode; // Resize and convert the frames on the CPU or in the inference plugin
         msdk_char strIRFileDir[MSDK_MAX_FILENAME_LEN]; // directory that contains IR files and label file
+        msdk_char strInferCacheDir[MSDK_MAX_FILENAME_LEN]; // directory that stores the compiled networks, empty to disable
+        msdk_char strInferCascadeModel[MSDK_MAX_FILENAME_LEN]; // cheap detector that decides which frames the model infers, empty to disable
+        mfxF64 InferCascadeThreshold; // The confidence of a cheap detection which escalates the frame
+        int InferHPFullFrameInterval; // Human pose infers crops around the people between full frames, 0 to disable
         char  strRtspSaveFile[MSDK_MAX_FILENAME_LEN]; // save rtsp to local file
 
 #endif
@@ -409,6 +436,15 @@ namespace TranscodingSample
         mfxSyncPoint      Syncp;
     };
 
+#if OVINO
+    // surface waiting in the queue of the inference thread
+    struct InferStageTask
+    {
+        ExtendedSurface ExtSurface;
+        bool            bRunInfer; // false means only render the last results
+    };
+#endif
+
     struct ExtendedBS
     {
         bool IsFree = true;
@@ -619,6 +655,8 @@ namespace TranscodingSample
         virtual mfxStatus SetReader(std::unique_ptr<CSmplYUVReader>& reader);
         virtual mfxStatus SetWriter(std::unique_ptr<CSmplBitstreamWriter>& writer);
         virtual mfxStatus GetInputBitstream(mfxBitstreamWrapper **pBitstream);
+        // Activity score of the next decoded frame from the coded packet sizes, -1 if unknown
+        virtual mfxF64 GetFrameActivity();
         virtual mfxStatus GetInputFrame(mfxFrameSurface1 *pSurface);
         virtual mfxStatus ProcessOutputBitstream(mfxBitstreamWrapper* pBitstream);
         virtual mfxStatus ResetInput();
@@ -758,6 +796,16 @@ namespace TranscodingSample
         mfxStatus AllocateSufficientBuffer(mfxBitstreamWrapper* pBS);
         mfxStatus PutBS();
 
+#if OVINO
+        mfxStatus InferFrame(mfxFrameSurface1 *pSurface, bool runInfer);
+        mfxStatus StartInferStage();
+        mfxStatus PushToInferStage(ExtendedSurface &extSurface, bool runInfer);
+        void      StopInferStage();
+        void      PrintInferStatistics();
+        static void InferStageRoutine(CTranscodingPipeline *pipeline);
+#endif
+        mfxStatus DeliverDecodedSurface(ExtendedSurface &extSurface);
+
         mfxStatus DumpSurface2File(mfxFrameSurface1* pSurface);
         mfxStatus Surface2BS(ExtendedSurface* pSurf,mfxBitstreamWrapper* pBS, mfxU32 fourCC);
         mfxStatus NV12toBS(mfxFrameSurface1* pSurface,mfxBitstreamWrapper* pBS);
@@ -966,9 +1014,16 @@ namespace TranscodingSample
 		int mInferOffline; // If true, the results won't be rendered
 		int mInferMaxObjNum;  // The maximum number of detected objects for classification
 		int mInferInterval; // The distance between two inferenced frame
+		InferCadence mInferCadence; // Chooses the inferred frames, adapts the interval if a rate is set
 		MediaInferenceManager::InferDeviceType mInferDevType;
 		msdk_char mStrIRFileDir[MSDK_MAX_FILENAME_LEN]; // directory that contains IR files and label file
 		MediaInferenceManager mInferMnger;
+		int mInferAsyncDepth; // Length of the queue feeding the inference thread, 0 runs inference in the decoding thread
+		std::thread *m_pInferThread;
+		std::deque<InferStageTask> m_InferQueue;
+		std::mutex m_mInferQueue;
+		std::condition_variable m_cvInferQueue;
+		mfxStatus m_InferStageSts; // the first error returned by the inference thread
 		int m_decOutW;  //The width of SFC or VPP output
 		int m_decOutH;  //The height of SFC or VPP output
 
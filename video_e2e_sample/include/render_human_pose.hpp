@@ -9,7 +9,8 @@
 #include <opencv2/core/core.hpp>
 
 #include "human_pose.hpp"
+#include "frame_canvas.h"
 
 namespace human_pose_estimation {
-    void renderHumanPose(const std::vector<HumanPose>& poses, cv::Mat& image);
+    void renderHumanPose(const std::vector<HumanPose>& poses, FrameCanvas& image);
 }  // namespace human_pose_estimation
@@ -0,0 +1,98 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#pragma once
+
+#include <emmintrin.h>
+
+/*
+ * Decoding of the output of an SSD DetectionOutput layer: rows of ObjectSize floats
+ * [image_id, label, confidence, x_min, y_min, x_max, y_max, ...] with coordinates normalized
+ * to the image, ended by a row whose image_id is negative. The row size, the label to keep
+ * (AnyLabel keeps all) and what is done with a detection are template parameters, so each
+ * detector gets a loop of its own without branches on them per row.
+ * The rows are checked 4 at a time with SSE: a group without a detection of the image above
+ * the threshold, and without the end row, is skipped as a whole.
+ */
+namespace SsdDecoder
+{
+const int AnyLabel = -1;
+/* The values of a detection of the DetectionOutput layer */
+const int DetectionSize = 7;
+
+/* Calls emit(label, confidence, x0, y0, x1, y1) for each detection of image batchIdx among the
+ * first count rows whose confidence is above threshold, in the order of the rows. emit returns
+ * false to stop the decoding */
+template <int ObjectSize, int Label, typename Emit>
+void Decode(const float *rows, int count, int batchIdx, float threshold, Emit &&emit)
+{
+    static_assert(ObjectSize >= 7, "SSD detections have at least 7 values");
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 image = _mm_set1_ps(static_cast<float>(batchIdx));
+    const __m128 label = _mm_set1_ps(static_cast<float>(Label));
+    const __m128 minConfidence = _mm_set1_ps(threshold);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const float *r = rows + i * ObjectSize;
+        const __m128 ids = _mm_setr_ps(r[0], r[ObjectSize], r[2 * ObjectSize], r[3 * ObjectSize]);
+        const __m128 confidences = _mm_setr_ps(r[2], r[ObjectSize + 2], r[2 * ObjectSize + 2], r[3 * ObjectSize + 2]);
+        __m128 keep = _mm_and_ps(_mm_cmpeq_ps(ids, image), _mm_cmpgt_ps(confidences, minConfidence));
+        if (Label != AnyLabel)
+        {
+            const __m128 labels = _mm_setr_ps(r[1], r[ObjectSize + 1], r[2 * ObjectSize + 1], r[3 * ObjectSize + 1]);
+            keep = _mm_and_ps(keep, _mm_cmpeq_ps(labels, label));
+        }
+        const int ends = _mm_movemask_ps(_mm_cmplt_ps(ids, zero));
+        // The rows after the end row are not detections
+        int kept = _mm_movemask_ps(keep);
+        if (ends)
+        {
+            kept &= (ends & -ends) - 1;
+        }
+        for (; kept; kept &= kept - 1)
+        {
+            const int j = (kept & 1) ? 0 : (kept & 2) ? 1 : (kept & 4) ? 2 : 3;
+            const float *d = r + j * ObjectSize;
+            if (!emit(static_cast<int>(d[1]), d[2], d[3], d[4], d[5], d[6]))
+            {
+                return;
+            }
+        }
+        if (ends)
+        {
+            return;
+        }
+    }
+    for (; i < count; i++)
+    {
+        const float *d = rows + i * ObjectSize;
+        if (d[0] < 0)
+        {
+            return;
+        }
+        if (d[0] != batchIdx || !(d[2] > threshold) || (Label != AnyLabel && d[1] != Label))
+        {
+            continue;
+        }
+        if (!emit(static_cast<int>(d[1]), d[2], d[3], d[4], d[5], d[6]))
+        {
+            return;
+        }
+    }
+}
+}
@@ -4,10 +4,22 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include <inference_engine.hpp>
 #include <opencv2/core/core.hpp>
 
+#include "infer_request_pool.h"
+#include "infer_network_registry.h"
+#include "infer_preprocess.h"
+#include "frame_canvas.h"
+#include "detection_tiles.h"
+#include "infer_input_cache.h"
+
+class InferServer;
+
 struct VehicleDetectResult {
     int label;
     float confidence;
@@ -20,33 +32,113 @@ class VehicleDetect {
 public:
 
     VehicleDetect(bool mEnablePerformanceReport = false);
+    /* If maxBatch > 1, the detection runs in batches together with other sessions' frames.
+     * Otherwise numRequests requests are kept in flight, with more than one Detect() doesn't
+     * wait for the inference and returns the results of the latest completed frame.
+     * preprocMode is only used without batching, frameFormat is the format of the frames
+     * the plugin resizes in InferPreprocess::ModeIE. The vehicles of a frame are classified in
+     * batches of up to maxObjNum (at most mVAMaxBatch, all of them if negative) if the plugin supports
+     * dynamic batch, one at a time otherwise */
     void Init(const std::string& detectorModelPath,
             const std::string& VAModelPath,
-            const std::string& targetDeviceName);
-    void Detect(const cv::Mat& image, std::vector<VehicleDetectResult>& results, int maxObjNum);
+            const std::string& targetDeviceName,
+            int maxBatch = 1, int maxWaitMs = 0, int numRequests = 1,
+            InferPreprocess::Mode preprocMode = InferPreprocess::ModeCPU,
+            InferPreprocess::Format frameFormat = InferPreprocess::FormatRGB4,
+            int maxObjNum = -1);
+    /* Splits the frames into cols x rows overlapping tiles which are detected separately, as one
+     * batch, or on parallel requests in InferPreprocess::ModeIE. Call before Init(), the tiled
+     * detection doesn't use the batches shared with other sessions */
+    void SetTiles(int cols, int rows, float overlap);
+    /* The frames are detected as the tile part of a mosaic shared with the sessions of the other
+     * tiles, tile is normalized to the mosaic size. Call before Init(), tiles take precedence */
+    void SetMosaic(const cv::Rect2f& tile);
+    /* The frames are resized through cache, which is shared with the other models of the session */
+    void SetInputCache(InferInputCache* cache);
+    /* results are in the coordinates of frame. With more than one request, region tells apart the parts
+     * of the frame detected separately: the results are the latest completed ones of the same region */
+    void Detect(const InferPreprocess::Frame& frame, std::vector<VehicleDetectResult>& results, int maxObjNum,
+            int region = 0);
+    /* Moving average of the time from submitting a frame to its classified results, 0 if unknown */
+    double LatencyMs() const { return mServer ? 0 : mRequests.LatencyMs(); }
     void SetSrcImageSize(int width, int height);
-    void RenderVDResults(std::vector<VehicleDetectResult>& results, cv::Mat& image);
+    void RenderVDResults(const std::vector<VehicleDetectResult>& results, FrameCanvas& image);
     ~VehicleDetect();
 
 private:
 
+    static void SetupDetectorNetwork(InferenceEngine::CNNNetwork& network);
+    static void SetupVANetwork(InferenceEngine::CNNNetwork& network, int batchSize);
+    void ParseDetections(const float *detections, int batchIdx, const cv::Size& frameSize,
+            std::vector<VehicleDetectResult>& results, int maxObjNum);
+    void DetectTiles(const InferPreprocess::Frame& frame, std::vector<VehicleDetectResult>& results, int maxObjNum);
+    void Classify(const InferPreprocess::Frame& frame, std::vector<VehicleDetectResult>& results,
+            InferenceEngine::InferRequest& VARequest);
+    /* The vehicles of results inside frame and the indices of their results */
+    void CollectVehicles(const InferPreprocess::Frame& frame, const std::vector<VehicleDetectResult>& results,
+            std::vector<size_t>& indices, std::vector<InferPreprocess::Frame>& vehicles) const;
+    /* Fills the attributes input with the vehicles from first on, returns how many */
+    size_t FillVABatch(InferenceEngine::InferRequest& VARequest, const std::vector<InferPreprocess::Frame>& vehicles,
+            size_t first);
+    void ReadVABatch(InferenceEngine::InferRequest& VARequest, std::vector<VehicleDetectResult>& results,
+            const std::vector<size_t>& indices, size_t first, size_t count) const;
+    /* The attributes batches of a detection request run one after the other on the attributes request
+     * of its slot, started from the completion callbacks. The slot is released after the last one */
+    void ClassifyNextBatch(size_t slot);
+    void OnClassified(size_t slot, InferenceEngine::StatusCode status);
+    void PublishSlot(size_t slot);
+
     static std::mutex mInitLock;
     float mDetectThreshold;
-	InferenceEngine::Core ie;
+    std::shared_ptr<InferNetworkRegistry::Entry> mDetectorEntry;
     InferenceEngine::CNNNetwork mDetectorNetwork;
-    InferenceEngine::ExecutableNetwork mVDExecutableNetwork;
-    InferenceEngine::InferRequest mDetectorRequest;
+    InferRequestPool mRequests;
+    std::vector<InferPreprocess::Frame> mSlotFrames;
+    std::vector<std::vector<uint8_t>> mSlotPixels;
+    struct SlotClassification
+    {
+        unsigned int seq;
+        int region;
+        std::vector<VehicleDetectResult> objects;
+        std::vector<size_t> indices;
+        std::vector<InferPreprocess::Frame> vehicles;
+        size_t first; // the batch running
+        size_t count;
+    };
+    std::vector<SlotClassification> mSlotClassifications;
+    std::vector<uint8_t> mInputPlanes;
+    struct LatestResults
+    {
+        unsigned int seq = 0;
+        std::vector<VehicleDetectResult> objects;
+    };
+    std::mutex mResultsLock;
+    std::map<int, LatestResults> mLatestResults; // by region
+    unsigned int mSubmitted = 0;
     int mDetectorMaxProposalCount;
     int mDetectorObjectSize;
     std::string mDetectorRoiBlobName;
+    std::string mDetectorInputName;
+    cv::Size mDetectorInputSize;
     std::string mDetectorOutputName;
+    std::shared_ptr<InferServer> mServer;
+    DetectionTiles mTiles;
+    InferInputCache *mInputCache = nullptr;
+    bool mMosaic = false;
+    cv::Rect2f mMosaicTile;
+    cv::Rect mMosaicRect; // the tile in the detection input
+    InferPreprocess::Mode mPreprocMode = InferPreprocess::ModeCPU;
     bool mEnablePerformanceReport;
     cv::Size mSrcImageSize;
 
-	InferenceEngine::Core ie1;
+    std::shared_ptr<InferNetworkRegistry::Entry> mVAEntry;
     InferenceEngine::CNNNetwork mVANetwork;
-    InferenceEngine::ExecutableNetwork mVAExecutableNetwork;
-    InferenceEngine::InferRequest mVARequest;
+    std::vector<InferenceEngine::InferRequest> mVARequests;
+    int mVABatchSize = 1;
+    bool mVADynBatch = false; // the plugin accepts SetBatch(), so partial batches don't cost a full batch
+    static const int mVAMaxBatch = 16;
+    std::string mVAInputName;
+    cv::Size mVAInputSize;
     std::string mVAOutputNameForColor;  // color is the first output
     std::string mVAOutputNameForType;  // type is the second output
     static const std::string mVAColors[];
@@ -0,0 +1,184 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "detection_tiles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <emmintrin.h>
+
+namespace
+{
+// Part of the smaller box covered by the larger one above which they are the same object
+const float CONTAINED_THRESHOLD = 0.8f;
+
+/* Size of n tiles covering length with the given overlap, and the positions of the tiles */
+void SplitAxis(int length, int n, float overlap, int &tileLength, std::vector<int> &starts)
+{
+    tileLength = static_cast<int>(std::ceil(length / (n - (n - 1) * overlap)));
+    tileLength = std::min(tileLength, length);
+    starts.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        int start = (n > 1) ? static_cast<int>(static_cast<long long>(length - tileLength) * i / (n - 1)) : 0;
+        starts[i] = start & ~1;
+    }
+}
+}
+
+DetectionTiles::DetectionTiles() :
+    mCols(1),
+    mRows(1),
+    mOverlap(0)
+{
+}
+
+void DetectionTiles::Set(int cols, int rows, float overlap)
+{
+    mCols = std::max(cols, 1);
+    mRows = std::max(rows, 1);
+    mOverlap = std::min(std::max(overlap, 0.0f), 0.5f);
+}
+
+std::vector<cv::Rect> DetectionTiles::Split(int width, int height) const
+{
+    int tileWidth = 0;
+    int tileHeight = 0;
+    std::vector<int> xs;
+    std::vector<int> ys;
+    SplitAxis(width, mCols, mOverlap, tileWidth, xs);
+    SplitAxis(height, mRows, mOverlap, tileHeight, ys);
+
+    std::vector<cv::Rect> tiles;
+    for (int y : ys)
+    {
+        for (int x : xs)
+        {
+            tiles.push_back(cv::Rect(x, y, tileWidth, tileHeight));
+        }
+    }
+    return tiles;
+}
+
+cv::Rect DetectionTiles::MosaicRect(cv::Rect2f &tile, const cv::Size &inputSize)
+{
+    const int x0 = static_cast<int>(std::round(tile.x * inputSize.width));
+    const int y0 = static_cast<int>(std::round(tile.y * inputSize.height));
+    const int x1 = static_cast<int>(std::round((tile.x + tile.width) * inputSize.width));
+    const int y1 = static_cast<int>(std::round((tile.y + tile.height) * inputSize.height));
+    const cv::Rect rect = cv::Rect(x0, y0, std::max(x1 - x0, 1), std::max(y1 - y0, 1)) & cv::Rect(cv::Point(0, 0), inputSize);
+    tile = cv::Rect2f(static_cast<float>(rect.x) / inputSize.width, static_cast<float>(rect.y) / inputSize.height,
+        static_cast<float>(rect.width) / inputSize.width, static_cast<float>(rect.height) / inputSize.height);
+    return rect;
+}
+
+void DetectionTiles::CopyToMosaic(const uint8_t *planes, const cv::Rect &rect, uint8_t *input, const cv::Size &inputSize)
+{
+    const size_t rectPlaneSize = static_cast<size_t>(rect.area());
+    const size_t inputPlaneSize = static_cast<size_t>(inputSize.area());
+    for (size_t c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < rect.height; y++)
+        {
+            std::copy_n(planes + c * rectPlaneSize + static_cast<size_t>(y) * rect.width, rect.width,
+                input + c * inputPlaneSize + static_cast<size_t>(rect.y + y) * inputSize.width + rect.x);
+        }
+    }
+}
+
+bool DetectionTiles::FromMosaic(const cv::Rect2f &tile, float &x0, float &y0, float &x1, float &y1)
+{
+    const float cx = (x0 + x1) / 2;
+    const float cy = (y0 + y1) / 2;
+    if (cx < tile.x || cx >= tile.x + tile.width || cy < tile.y || cy >= tile.y + tile.height)
+    {
+        return false;
+    }
+    x0 = (x0 - tile.x) / tile.width;
+    x1 = (x1 - tile.x) / tile.width;
+    y0 = (y0 - tile.y) / tile.height;
+    y1 = (y1 - tile.y) / tile.height;
+    return true;
+}
+
+std::vector<size_t> DetectionTiles::NonMaxSuppression(const std::vector<cv::Rect> &boxes,
+    const std::vector<float> &scores, float iouThreshold)
+{
+    std::vector<size_t> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&scores](size_t a, size_t b) { return scores[a] > scores[b]; });
+
+    // The boxes by decreasing score as arrays of coordinates, padded with empty boxes to whole
+    // SSE vectors. An empty box never overlaps and is never dropped
+    const size_t count = order.size();
+    const size_t padded = (count + 3) & ~static_cast<size_t>(3);
+    std::vector<float> x0(padded, 0), y0(padded, 0), x1(padded, 0), y1(padded, 0), area(padded, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        const cv::Rect &box = boxes[order[i]];
+        x0[i] = static_cast<float>(box.x);
+        y0[i] = static_cast<float>(box.y);
+        x1[i] = static_cast<float>(box.x + box.width);
+        y1[i] = static_cast<float>(box.y + box.height);
+        area[i] = static_cast<float>(box.area());
+    }
+
+    std::vector<uint8_t> dropped(padded, 0);
+    std::vector<size_t> kept;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 iou = _mm_set1_ps(iouThreshold);
+    const __m128 contained = _mm_set1_ps(CONTAINED_THRESHOLD);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (dropped[i])
+        {
+            continue;
+        }
+        kept.push_back(order[i]);
+
+        const __m128 ix0 = _mm_set1_ps(x0[i]);
+        const __m128 iy0 = _mm_set1_ps(y0[i]);
+        const __m128 ix1 = _mm_set1_ps(x1[i]);
+        const __m128 iy1 = _mm_set1_ps(y1[i]);
+        const __m128 iarea = _mm_set1_ps(area[i]);
+        // Compares box i with the 4 boxes of each vector after it
+        for (size_t j = (i + 1) & ~static_cast<size_t>(3); j < padded; j += 4)
+        {
+            const __m128 w = _mm_max_ps(zero,
+                _mm_sub_ps(_mm_min_ps(ix1, _mm_loadu_ps(&x1[j])), _mm_max_ps(ix0, _mm_loadu_ps(&x0[j]))));
+            const __m128 h = _mm_max_ps(zero,
+                _mm_sub_ps(_mm_min_ps(iy1, _mm_loadu_ps(&y1[j])), _mm_max_ps(iy0, _mm_loadu_ps(&y0[j]))));
+            const __m128 inter = _mm_mul_ps(w, h);
+            const __m128 jarea = _mm_loadu_ps(&area[j]);
+            // inter / union > iou and inter / min(area) > contained, without divisions
+            const __m128 overlapping = _mm_cmpgt_ps(inter,
+                _mm_mul_ps(iou, _mm_sub_ps(_mm_add_ps(iarea, jarea), inter)));
+            const __m128 inside = _mm_cmpgt_ps(inter, _mm_mul_ps(contained, _mm_min_ps(iarea, jarea)));
+            const int mask = _mm_movemask_ps(_mm_or_ps(overlapping, inside));
+            for (int k = 0; k < 4; k++)
+            {
+                // Boxes of the vector up to i are already decided
+                if ((mask & (1 << k)) && j + k > i)
+                {
+                    dropped[j + k] = 1;
+                }
+            }
+        }
+    }
+    return kept;
+}
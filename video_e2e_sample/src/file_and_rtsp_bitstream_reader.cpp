@@ -26,6 +26,8 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 
 #include "file_and_rtsp_bitstream_reader.h"
 
+#include <limits>
+
 
 FileAndRTSPBitstreamReader::FileAndRTSPBitstreamReader()
 	:CSmplBitstreamReader()
@@ -39,6 +41,7 @@ FileAndRTSPBitstreamReader::FileAndRTSPBitstreamReader()
 	m_rtsp_status = RTSP_NOT_CONNECT;
 	m_rtsp_queue_size = 100;
 	m_rtsp_file = nullptr;
+	m_key_frame_size = 0;
 #endif
 }
 
@@ -255,6 +258,7 @@ mfxStatus FileAndRTSPBitstreamReader::ReadNextFrame(mfxBitstream *pBS)
 					msdk_printf(MSDK_STRING("Bitstream buffer overflow! RTSP packet size: %zu, buffer size: %d\n"),
 						packet->size, nLeftBufferSize);
 				}
+				PushFrameActivity(packet);
 				free(packet->data);
 				packet->data = nullptr;
 				delete packet;
@@ -293,6 +297,20 @@ mfxStatus FileAndRTSPBitstreamReader::ReadNextFrame(mfxBitstream *pBS)
 	return MFX_ERR_NONE;
 }
 
+mfxF64 FileAndRTSPBitstreamReader::PopFrameActivity()
+{
+#ifdef RTSP_SUPPORT
+	if (m_bIsRTSP && !m_frame_activity.empty())
+	{
+		mfxF64 activity = m_frame_activity.front();
+		m_frame_activity.pop_front();
+		return activity;
+	}
+#endif
+	// The file is read in chunks which don't follow the frames
+	return -1;
+}
+
 
 #ifdef RTSP_SUPPORT
 void FileAndRTSPBitstreamReader::RtspPacketReader(FileAndRTSPBitstreamReader  *ctx)
@@ -347,6 +365,7 @@ void FileAndRTSPBitstreamReader::RtspPacketReader(FileAndRTSPBitstreamReader  *c
 
 		PacketData *pData = new PacketData;
 		pData->size = packet.size;
+		pData->key = (packet.flags & AV_PKT_FLAG_KEY) != 0;
 		pData->data = malloc(pData->size);
 		if (pData->data && (packet.size > 0))
 		{
@@ -375,6 +394,31 @@ void FileAndRTSPBitstreamReader::RtspPacketReader(FileAndRTSPBitstreamReader  *c
 	return;
 }
 
+void FileAndRTSPBitstreamReader::PushFrameActivity(const PacketData *packet)
+{
+	mfxF64 activity = -1;
+	if (packet->key)
+	{
+		// A moving average over a few GOPs, so one odd key frame doesn't change all the scores
+		m_key_frame_size = (m_key_frame_size > 0) ?
+			m_key_frame_size + ((mfxF64)packet->size - m_key_frame_size) / 4 : (mfxF64)packet->size;
+		// A key frame inserted at a scene cut or a camera move is the strongest change in the stream,
+		// it reaches any threshold so a GOP restart never skips the inference
+		activity = std::numeric_limits<mfxF64>::infinity();
+	}
+	else if (m_key_frame_size > 0)
+	{
+		activity = (mfxF64)packet->size / m_key_frame_size;
+	}
+
+	// Packets only pair with decoded frames while nothing is lost, don't let a mismatch grow
+	m_frame_activity.push_back(activity);
+	if (m_frame_activity.size() > RTSP_QUEUE_MAX_SIZE)
+	{
+		m_frame_activity.pop_front();
+	}
+}
+
 void FileAndRTSPBitstreamReader::StartRTSPThread()
 {
 	av_read_play(m_context);
@@ -0,0 +1,205 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "frame_canvas.h"
+
+#include <algorithm>
+
+#include <emmintrin.h>
+
+namespace
+{
+/* The chroma plane has half the resolution of the luma */
+cv::Point Half(cv::Point p)
+{
+    return cv::Point(p.x / 2, p.y / 2);
+}
+
+int HalfThickness(int thickness)
+{
+    // Negative thickness means filled
+    return thickness < 0 ? thickness : std::max(thickness / 2, 1);
+}
+
+/* dst = (dst * (256 - weight) + src * weight + 128) / 256, n bytes. Equal bytes stay the same */
+void BlendBytes(uint8_t *dst, const uint8_t *src, int n, int weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i srcWeight = _mm_set1_epi16((short)weight);
+    const __m128i dstWeight = _mm_set1_epi16((short)(256 - weight));
+    const __m128i half = _mm_set1_epi16(128);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        // At most 255 * 256 + 128, the 16 bit lanes don't overflow as unsigned
+        const __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        const __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), dstWeight),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), srcWeight));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), dstWeight),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), srcWeight));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    for (; i < n; i++)
+    {
+        dst[i] = (uint8_t)((dst[i] * (256 - weight) + src[i] * weight + 128) >> 8);
+    }
+}
+
+/* Fills the polygons on a copy of the pixels around them and blends the copy back. Polygons whose
+ * bounding boxes overlap share a copy, so the last one covers the others as on a whole frame copy */
+void BlendPolys(cv::Mat &plane, const std::vector<std::vector<cv::Point>> &polygons,
+    const std::vector<cv::Scalar> &colors, int weight)
+{
+    const cv::Rect planeRect(0, 0, plane.cols, plane.rows);
+    std::vector<cv::Rect> regions;
+    std::vector<std::vector<size_t>> regionPolygons;
+    for (size_t i = 0; i < polygons.size(); i++)
+    {
+        cv::Rect box = cv::boundingRect(polygons[i]) & planeRect;
+        if (box.area() == 0)
+            continue;
+        std::vector<size_t> members(1, i);
+        for (size_t r = 0; r < regions.size();)
+        {
+            if ((regions[r] & box).area() == 0)
+            {
+                r++;
+                continue;
+            }
+            // The grown box may overlap the regions already passed
+            box |= regions[r];
+            members.insert(members.end(), regionPolygons[r].begin(), regionPolygons[r].end());
+            regions.erase(regions.begin() + r);
+            regionPolygons.erase(regionPolygons.begin() + r);
+            r = 0;
+        }
+        std::sort(members.begin(), members.end());
+        regions.push_back(box);
+        regionPolygons.push_back(std::move(members));
+    }
+
+    static thread_local cv::Mat pane;
+    std::vector<cv::Point> shifted;
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        const cv::Rect &region = regions[r];
+        plane(region).copyTo(pane);
+        for (size_t i : regionPolygons[r])
+        {
+            shifted.resize(polygons[i].size());
+            for (size_t p = 0; p < shifted.size(); p++)
+                shifted[p] = polygons[i][p] - region.tl();
+            cv::fillConvexPoly(pane, shifted, colors[i]);
+        }
+        const int rowBytes = region.width * (int)plane.elemSize();
+        for (int y = 0; y < region.height; y++)
+        {
+            BlendBytes(plane.ptr(region.y + y) + region.x * plane.elemSize(), pane.ptr(y), rowBytes, weight);
+        }
+    }
+}
+}
+
+FrameCanvas::FrameCanvas(const cv::Mat &rgb4) :
+    mImage(rgb4)
+{
+}
+
+FrameCanvas::FrameCanvas(const cv::Mat &y, const cv::Mat &uv) :
+    mImage(y),
+    mUV(uv)
+{
+}
+
+cv::Scalar FrameCanvas::LumaColor(const cv::Scalar &color) const
+{
+    if (!IsNV12())
+        return color;
+    // BT.601, limited range
+    const double b = color[0], g = color[1], r = color[2];
+    return cv::Scalar(16 + (66 * r + 129 * g + 25 * b) / 256);
+}
+
+cv::Scalar FrameCanvas::ChromaColor(const cv::Scalar &color) const
+{
+    const double b = color[0], g = color[1], r = color[2];
+    return cv::Scalar(128 + (-38 * r - 74 * g + 112 * b) / 256, 128 + (112 * r - 94 * g - 18 * b) / 256);
+}
+
+void FrameCanvas::Rectangle(const cv::Rect &rect, const cv::Scalar &color, int thickness)
+{
+    cv::rectangle(mImage, rect, LumaColor(color), thickness);
+    if (IsNV12())
+    {
+        cv::Rect half(rect.x / 2, rect.y / 2, rect.width / 2, rect.height / 2);
+        cv::rectangle(mUV, half, ChromaColor(color), HalfThickness(thickness));
+    }
+}
+
+void FrameCanvas::Text(const std::string &text, cv::Point org, int fontFace, double fontScale,
+    const cv::Scalar &color, int thickness, int lineType)
+{
+    cv::putText(mImage, text, org, fontFace, fontScale, LumaColor(color), thickness, lineType);
+    if (IsNV12())
+    {
+        cv::putText(mUV, text, Half(org), fontFace, fontScale / 2, ChromaColor(color),
+            HalfThickness(thickness), lineType);
+    }
+}
+
+void FrameCanvas::Circle(cv::Point center, int radius, const cv::Scalar &color, int thickness)
+{
+    cv::circle(mImage, center, radius, LumaColor(color), thickness);
+    if (IsNV12())
+    {
+        cv::circle(mUV, Half(center), std::max(radius / 2, 1), ChromaColor(color), HalfThickness(thickness));
+    }
+}
+
+void FrameCanvas::FillConvexPoly(const std::vector<cv::Point> &points, const cv::Scalar &color)
+{
+    cv::fillConvexPoly(mImage, points, LumaColor(color));
+    if (IsNV12())
+    {
+        std::vector<cv::Point> half(points.size());
+        std::transform(points.begin(), points.end(), half.begin(), Half);
+        cv::fillConvexPoly(mUV, half, ChromaColor(color));
+    }
+}
+
+void FrameCanvas::BlendConvexPolys(const std::vector<std::vector<cv::Point>> &polygons,
+    const std::vector<cv::Scalar> &colors, double alpha)
+{
+    const int weight = cvRound(alpha * 256);
+    std::vector<cv::Scalar> planeColors(colors.size());
+    for (size_t i = 0; i < colors.size(); i++)
+        planeColors[i] = LumaColor(colors[i]);
+    BlendPolys(mImage, polygons, planeColors, weight);
+    if (IsNV12())
+    {
+        std::vector<std::vector<cv::Point>> half(polygons.size());
+        for (size_t i = 0; i < polygons.size(); i++)
+        {
+            half[i].resize(polygons[i].size());
+            std::transform(polygons[i].begin(), polygons[i].end(), half[i].begin(), Half);
+            planeColors[i] = ChromaColor(colors[i]);
+        }
+        BlendPolys(mUV, half, planeColors, weight);
+    }
+}
@@ -0,0 +1,162 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "infer_cadence.h"
+
+#include <algorithm>
+#include <cmath>
+
+InferCadence::InferCadence() :
+    mInterval(1),
+    mMinInterval(1),
+    mMaxInterval(1),
+    mTargetRate(0),
+    mInputFps(30),
+    mLatencyMs(0),
+    mSaturated(false),
+    mSinceInferred(0),
+    mFrames(0),
+    mInferred(0),
+    mActivityThreshold(0),
+    mActivity(0),
+    mActivityUnknown(true),
+    mInactive(0)
+{
+}
+
+void InferCadence::Init(int interval, int minInterval, int maxInterval, double targetRate, double inputFps)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mMinInterval = (minInterval > 0) ? minInterval : 1;
+    mMaxInterval = (maxInterval > 0) ? maxInterval : std::max(interval, 30);
+    mMaxInterval = std::max(mMaxInterval, mMinInterval);
+    mTargetRate = targetRate;
+    mInputFps = (inputFps > 0) ? inputFps : 30;
+    mInterval = std::max(interval, 1);
+    if (mTargetRate > 0)
+    {
+        mInterval = std::min(std::max(mInterval, mMinInterval), mMaxInterval);
+    }
+    mLatencyMs = 0;
+    mSaturated = false;
+    // The first frame is inferred
+    mSinceInferred = mInterval - 1;
+    mFrames = 0;
+    mInferred = 0;
+    mActivity = 0;
+    mActivityUnknown = true;
+    mInactive = 0;
+}
+
+void InferCadence::SetActivityThreshold(double threshold)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mActivityThreshold = threshold;
+}
+
+bool InferCadence::NextFrame(double activity)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mFrames++;
+    if (activity < 0)
+    {
+        mActivityUnknown = true;
+    }
+    else
+    {
+        mActivity += activity;
+    }
+    if (++mSinceInferred < mInterval)
+    {
+        return false;
+    }
+    mSinceInferred = 0;
+    // Nothing moved enough since the last inferred frame, its results still hold. The activity keeps
+    // adding up, so slow motion is inferred eventually
+    if (mActivityThreshold > 0 && !mActivityUnknown && mActivity < mActivityThreshold)
+    {
+        mInactive++;
+        return false;
+    }
+    mActivity = 0;
+    mActivityUnknown = false;
+    mInferred++;
+    if (mTargetRate > 0)
+    {
+        Adapt();
+    }
+    return true;
+}
+
+void InferCadence::Adapt()
+{
+    // The interval giving the target rate, and the one at which an inference lasts no longer than
+    // the frames until the next one
+    int rateInterval = static_cast<int>(std::lround(mInputFps / mTargetRate));
+    int latencyInterval = static_cast<int>(std::ceil(mLatencyMs * mInputFps / 1000));
+    int wanted = std::max(rateInterval, latencyInterval);
+    if (mSaturated)
+    {
+        wanted = std::max(wanted, mInterval + 1);
+    }
+    wanted = std::min(std::max(wanted, mMinInterval), mMaxInterval);
+
+    // Back off at once, come back one step at a time so a single fast inference doesn't overload the device again
+    if (wanted > mInterval)
+    {
+        mInterval = wanted;
+    }
+    else if (wanted < mInterval)
+    {
+        mInterval--;
+    }
+}
+
+void InferCadence::InferenceDone(double ms)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mLatencyMs = (mLatencyMs > 0) ? mLatencyMs + (ms - mLatencyMs) / 8 : ms;
+}
+
+void InferCadence::SetBacklog(size_t queued, size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mSaturated = (capacity > 0 && queued >= capacity);
+}
+
+int InferCadence::Interval() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mInterval;
+}
+
+unsigned int InferCadence::InferredFrames() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mInferred;
+}
+
+unsigned int InferCadence::Frames() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mFrames;
+}
+
+unsigned int InferCadence::InactiveFrames() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mInactive;
+}
@@ -0,0 +1,68 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "infer_frame_blob.h"
+
+using namespace InferenceEngine;
+
+void InferFrameBlob::SetupInput(const InputInfo::Ptr &input, InferPreprocess::Format format)
+{
+    input->setPrecision(Precision::U8);
+    PreProcessInfo &preProcess = input->getPreProcess();
+    preProcess.setResizeAlgorithm(RESIZE_BILINEAR);
+    if (format == InferPreprocess::FormatNV12)
+    {
+        input->setLayout(Layout::NCHW);
+        preProcess.setColorFormat(ColorFormat::NV12);
+    }
+    else
+    {
+        input->setLayout(Layout::NHWC);
+        // The byte order the CPU path uses, see InferPreprocess::ResizeToPlanarBGR()
+        preProcess.setColorFormat(ColorFormat::RGBX);
+    }
+}
+
+std::string InferFrameBlob::NetworkTag(InferPreprocess::Format format)
+{
+    return (format == InferPreprocess::FormatNV12) ? "ie-nv12" : "ie";
+}
+
+namespace
+{
+/* An NHWC blob of U8 pixels with the given number of channels and bytes per row */
+Blob::Ptr WrapPlane(const uint8_t *data, size_t width, size_t height, size_t channels, size_t pitch)
+{
+    // Dims are in NCHW order
+    TensorDesc desc(Precision::U8, { 1, channels, height, width },
+        BlockingDesc({ 1, height, width, channels }, { 0, 2, 3, 1 }, 0, { 0, 0, 0, 0 },
+            { height * pitch, pitch, channels, 1 }));
+    return make_shared_blob<uint8_t>(desc, const_cast<uint8_t *>(data));
+}
+}
+
+Blob::Ptr InferFrameBlob::Wrap(const InferPreprocess::Frame &frame)
+{
+    if (frame.format == InferPreprocess::FormatNV12)
+    {
+        // The luma must have twice the size of the chroma, an odd last column or row is left out
+        const size_t width = frame.width & ~1;
+        const size_t height = frame.height & ~1;
+        return make_shared_blob<NV12Blob>(WrapPlane(frame.data, width, height, 1, frame.pitch),
+            WrapPlane(frame.uv, width / 2, height / 2, 2, frame.pitch));
+    }
+    return WrapPlane(frame.data, frame.width, frame.height, 4, frame.pitch);
+}
@@ -0,0 +1,100 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "infer_input_cache.h"
+
+#include <algorithm>
+
+InferInputCache::InferInputCache():
+    mFrame()
+{
+}
+
+void InferInputCache::Reset(const InferPreprocess::Frame &frame)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mFrame = frame;
+    for (auto &entry : mEntries)
+    {
+        entry.second->ready = false;
+    }
+}
+
+bool InferInputCache::IsFrame(const InferPreprocess::Frame &frame) const
+{
+    return frame.data == mFrame.data && frame.uv == mFrame.uv && frame.width == mFrame.width
+        && frame.height == mFrame.height && frame.pitch == mFrame.pitch && frame.format == mFrame.format;
+}
+
+const uint8_t *InferInputCache::Planes(int width, int height)
+{
+    Entry *entry;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        std::unique_ptr<Entry> &slot = mEntries[std::make_pair(width, height)];
+        if (!slot)
+        {
+            slot.reset(new Entry);
+        }
+        entry = slot.get();
+    }
+    // A model asking for the same size waits for the first one to resize it
+    std::lock_guard<std::mutex> lock(entry->lock);
+    if (!entry->ready)
+    {
+        const size_t planeSize = static_cast<size_t>(width) * height;
+        entry->planes.resize(3 * planeSize);
+        InferPreprocess::ResizeToPlanarBGR(mFrame, entry->planes.data(), width, height, width, planeSize);
+        entry->ready = true;
+    }
+    return entry->planes.data();
+}
+
+void InferInputCache::ResizeToPlanarBGR(InferInputCache *cache, const InferPreprocess::Frame &src, uint8_t *dst,
+    int dstWidth, int dstHeight, size_t dstStride, size_t planeStride)
+{
+    bool cached;
+    if (cache)
+    {
+        std::lock_guard<std::mutex> lock(cache->mLock);
+        cached = cache->IsFrame(src);
+    }
+    else
+    {
+        cached = false;
+    }
+    if (!cached)
+    {
+        InferPreprocess::ResizeToPlanarBGR(src, dst, dstWidth, dstHeight, dstStride, planeStride);
+        return;
+    }
+
+    const uint8_t *planes = cache->Planes(dstWidth, dstHeight);
+    const size_t planeSize = static_cast<size_t>(dstWidth) * dstHeight;
+    if (dstStride == static_cast<size_t>(dstWidth) && planeStride == planeSize)
+    {
+        std::copy_n(planes, 3 * planeSize, dst);
+        return;
+    }
+    for (size_t c = 0; c < 3; c++)
+    {
+        for (int y = 0; y < dstHeight; y++)
+        {
+            std::copy_n(planes + c * planeSize + static_cast<size_t>(y) * dstWidth, dstWidth,
+                dst + c * planeStride + y * dstStride);
+        }
+    }
+}
@@ -0,0 +1,319 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "infer_model.h"
+#include "render_human_pose.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace human_pose_estimation;
+
+namespace
+{
+// The keypoints don't reach the top of the head or the feet, and the people move between frames
+const float PoseCropMargin = 0.3f;
+// More or larger crops cost about as much as the whole frame
+const size_t MaxPoseCrops = 4;
+
+cv::Rect2f PoseBox(const HumanPose &pose)
+{
+    // The box around the keypoints found
+    const cv::Point2f absentKeypoint(-1.0f, -1.0f);
+    cv::Point2f tl(FLT_MAX, FLT_MAX);
+    cv::Point2f br(-FLT_MAX, -FLT_MAX);
+    for (const cv::Point2f &keypoint : pose.keypoints)
+    {
+        if (keypoint == absentKeypoint)
+            continue;
+        tl.x = std::min(tl.x, keypoint.x);
+        tl.y = std::min(tl.y, keypoint.y);
+        br.x = std::max(br.x, keypoint.x);
+        br.y = std::max(br.y, keypoint.y);
+    }
+    return tl.x > br.x ? cv::Rect2f() : cv::Rect2f(tl, br);
+}
+
+struct PoseCrop
+{
+    cv::Rect2f people; // the union of the boxes of its people
+    int count;         // its people
+    cv::Rect crop;
+};
+
+// A square around people with the margin, inside the frame. The network input of a square crop is
+// the same for all of them. It starts at even coordinates for the NV12 frames
+cv::Rect SquareCrop(const cv::Rect2f &people, const cv::Size &frameSize)
+{
+    const float side = std::max(people.width, people.height) * (1 + 2 * PoseCropMargin);
+    const int size = std::min(std::max((int)std::ceil(side), 2), std::min(frameSize.width, frameSize.height)) & ~1;
+    const int x = std::min(std::max(cvRound(people.x + people.width / 2 - size / 2), 0), frameSize.width - size);
+    const int y = std::min(std::max(cvRound(people.y + people.height / 2 - size / 2), 0), frameSize.height - size);
+    return cv::Rect(x & ~1, y & ~1, size, size);
+}
+}
+
+InferModelWorker::InferModelWorker(InferModel *model) :
+    mModel(model),
+    mFrame(nullptr),
+    mRegions(nullptr),
+    mBusy(false),
+    mStop(false),
+    mThread(&InferModelWorker::Run, this)
+{
+}
+
+InferModelWorker::~InferModelWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStop = true;
+    }
+    mCond.notify_all();
+    mThread.join();
+}
+
+void InferModelWorker::Start(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions)
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mFrame = &frame;
+        mRegions = &regions;
+        mBusy = true;
+    }
+    mCond.notify_all();
+}
+
+void InferModelWorker::Wait()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    mCond.wait(lock, [this] { return !mBusy; });
+    if (mError)
+    {
+        std::exception_ptr error = mError;
+        mError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void InferModelWorker::Run()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    for (;;)
+    {
+        mCond.wait(lock, [this] { return mStop || mBusy; });
+        if (mStop)
+        {
+            return;
+        }
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            mModel->Infer(*mFrame, *mRegions);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        mError = error;
+        mBusy = false;
+        mCond.notify_all();
+    }
+}
+
+void FaceDetectModel::Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions)
+{
+    FDDetectedObjects objects;
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        const cv::Rect &region = regions[r];
+        mDetector->results.clear();
+        mDetector->Detect(frame.Roi(region.x, region.y, region.width, region.height), (int)r);
+        for (FDDetectedObject &object : mDetector->results)
+        {
+            object.rect += region.tl();
+            objects.push_back(object);
+        }
+    }
+    mDetector->results.swap(objects);
+}
+
+void FaceDetectModel::Render(FrameCanvas &canvas) const
+{
+    mDetector->RenderFDResults(canvas);
+}
+
+void FaceDetectModel::GetBoxes(std::vector<cv::Rect2f> &boxes) const
+{
+    for (const FDDetectedObject &object : mDetector->results)
+        boxes.push_back(cv::Rect2f(object.rect));
+}
+
+size_t FaceDetectModel::MoveBoxes(const cv::Rect2f *, const cv::Rect2f *to, size_t count)
+{
+    FDDetectedObjects &results = mDetector->results;
+    for (size_t i = 0; i < results.size() && i < count; i++)
+        results[i].rect = cv::Rect(to[i]);
+    return results.size();
+}
+
+void VehicleDetectModel::Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &regions)
+{
+    mResults.clear();
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        const cv::Rect &region = regions[r];
+        const int maxObjNum = (mMaxObjNum < 0) ? -1 : mMaxObjNum - (int)mResults.size();
+        if (maxObjNum == 0)
+        {
+            break;
+        }
+        std::vector<VehicleDetectResult> objects;
+        mDetector->Detect(frame.Roi(region.x, region.y, region.width, region.height), objects, maxObjNum, (int)r);
+        for (VehicleDetectResult &object : objects)
+        {
+            object.location += region.tl();
+            mResults.push_back(object);
+        }
+    }
+}
+
+void VehicleDetectModel::Render(FrameCanvas &canvas) const
+{
+    mDetector->RenderVDResults(mResults, canvas);
+}
+
+void VehicleDetectModel::GetBoxes(std::vector<cv::Rect2f> &boxes) const
+{
+    for (const VehicleDetectResult &result : mResults)
+        boxes.push_back(cv::Rect2f(result.location));
+}
+
+size_t VehicleDetectModel::MoveBoxes(const cv::Rect2f *, const cv::Rect2f *to, size_t count)
+{
+    for (size_t i = 0; i < mResults.size() && i < count; i++)
+        mResults[i].location = cv::Rect(to[i]);
+    return mResults.size();
+}
+
+void HumanPoseModel::Infer(const InferPreprocess::Frame &frame, const std::vector<cv::Rect> &)
+{
+    if (mFullFrameInterval > 0 && mCropFrames + 1 < mFullFrameInterval && InferCrops(frame))
+    {
+        mCropFrames++;
+        return;
+    }
+    mPoses = mEstimator->estimate(frame);
+    mCropFrames = 0;
+}
+
+bool HumanPoseModel::InferCrops(const InferPreprocess::Frame &frame)
+{
+    // The people of the last poses, moved by the tracking if it's on
+    const cv::Size frameSize(frame.width, frame.height);
+    std::vector<PoseCrop> crops;
+    for (const HumanPose &pose : mPoses)
+    {
+        const cv::Rect2f box = PoseBox(pose);
+        if (box.area() > 0)
+            crops.push_back({ box, 1, SquareCrop(box, frameSize) });
+    }
+    if (crops.empty())
+        return false;
+
+    // The people of overlapping crops go into one crop, until none overlap
+    for (bool merged = true; merged;)
+    {
+        merged = false;
+        for (size_t i = 0; i < crops.size() && !merged; i++)
+        {
+            for (size_t j = i + 1; j < crops.size() && !merged; j++)
+            {
+                if ((crops[i].crop & crops[j].crop).area() == 0)
+                    continue;
+                crops[i].people |= crops[j].people;
+                crops[i].count += crops[j].count;
+                crops[i].crop = SquareCrop(crops[i].people, frameSize);
+                crops.erase(crops.begin() + j);
+                merged = true;
+            }
+        }
+    }
+    int cropArea = 0;
+    std::vector<cv::Rect> rois;
+    for (const PoseCrop &crop : crops)
+    {
+        cropArea += crop.crop.area();
+        rois.push_back(crop.crop);
+    }
+    if (crops.size() > MaxPoseCrops || cropArea > frameSize.area() / 2)
+        return false;
+
+    std::vector<std::vector<HumanPose>> cropPoses = mEstimator->estimateRois(frame, rois);
+    std::vector<HumanPose> poses;
+    for (size_t i = 0; i < crops.size(); i++)
+    {
+        // The people cut by the border of the crop belong to another crop or are new
+        const cv::Rect2f &people = crops[i].people;
+        const float margin = std::max(people.width, people.height) * PoseCropMargin / 2;
+        const cv::Rect2f area(people.x - margin, people.y - margin, people.width + 2 * margin, people.height + 2 * margin);
+        int found = 0;
+        for (HumanPose &pose : cropPoses[i])
+        {
+            const cv::Rect2f box = PoseBox(pose);
+            if (box.area() > 0 && area.contains(cv::Point2f(box.x + box.width / 2, box.y + box.height / 2)))
+            {
+                poses.push_back(std::move(pose));
+                found++;
+            }
+        }
+        if (found < crops[i].count)
+            return false;
+    }
+    mPoses.swap(poses);
+    return true;
+}
+
+void HumanPoseModel::Render(FrameCanvas &canvas) const
+{
+    renderHumanPose(mPoses, canvas);
+}
+
+void HumanPoseModel::GetBoxes(std::vector<cv::Rect2f> &boxes) const
+{
+    for (const HumanPose &pose : mPoses)
+        boxes.push_back(PoseBox(pose));
+}
+
+size_t HumanPoseModel::MoveBoxes(const cv::Rect2f *from, const cv::Rect2f *to, size_t count)
+{
+    // The keypoints move and scale with the box around them
+    for (size_t i = 0; i < mPoses.size() && i < count; i++)
+    {
+        const float scaleX = from[i].width > 0 ? to[i].width / from[i].width : 1.0f;
+        const float scaleY = from[i].height > 0 ? to[i].height / from[i].height : 1.0f;
+        for (cv::Point2f &keypoint : mPoses[i].keypoints)
+        {
+            if (keypoint == cv::Point2f(-1.0f, -1.0f))
+                continue;
+            keypoint.x = to[i].x + (keypoint.x - from[i].x) * scaleX;
+            keypoint.y = to[i].y + (keypoint.y - from[i].y) * scaleY;
+        }
+    }
+    return mPoses.size();
+}
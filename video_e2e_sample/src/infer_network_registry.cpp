@@ -0,0 +1,250 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdio>
+
+#include "infer_network_registry.h"
+
+using namespace InferenceEngine;
+
+std::mutex InferNetworkRegistry::sLock;
+std::map<std::string, InferNetworkRegistry::Slot> InferNetworkRegistry::sEntries;
+std::mutex InferNetworkRegistry::sReadLock;
+std::map<std::string, std::weak_ptr<const CNNNetwork>> InferNetworkRegistry::sReadNetworks;
+std::string InferNetworkRegistry::sCacheDir;
+
+namespace {
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    void HashBytes(uint64_t &hash, const char *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    void HashString(uint64_t &hash, const std::string &str)
+    {
+        // The terminating zero keeps "ab"+"c" and "a"+"bc" apart
+        HashBytes(hash, str.c_str(), str.size() + 1);
+    }
+
+    bool HashFile(uint64_t &hash, const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        std::vector<char> buffer(1 << 20);
+        while (file)
+        {
+            file.read(buffer.data(), buffer.size());
+            HashBytes(hash, buffer.data(), (size_t)file.gcount());
+        }
+        return true;
+    }
+}
+
+Core &InferNetworkRegistry::GetCore()
+{
+    // Never destroyed: the plugins must not be unloaded during static destruction
+    static Core *core = new Core();
+    return *core;
+}
+
+void InferNetworkRegistry::SetCacheDir(const std::string &dir)
+{
+    std::lock_guard<std::mutex> lock(sLock);
+    sCacheDir = dir;
+}
+
+std::shared_ptr<const CNNNetwork> InferNetworkRegistry::ReadNetwork(const std::string &modelPath)
+{
+    std::lock_guard<std::mutex> lock(sReadLock);
+    std::shared_ptr<const CNNNetwork> network = sReadNetworks[modelPath].lock();
+    if (!network)
+    {
+        network = std::make_shared<const CNNNetwork>(GetCore().ReadNetwork(modelPath));
+        sReadNetworks[modelPath] = network;
+    }
+    return network;
+}
+
+std::shared_ptr<InferNetworkRegistry::Entry> InferNetworkRegistry::Load(const std::string &modelPath,
+    const std::string &device, const std::string &setupTag, const NetworkSetup &setup,
+    const std::map<std::string, std::string> &config)
+{
+    std::string key = modelPath + "|" + device + "|" + setupTag;
+    for (auto it = config.begin(); it != config.end(); ++it)
+    {
+        key += "|" + it->first + "=" + it->second;
+    }
+
+    // Only the first caller of a key loads it, the others wait for it. Different keys load in parallel
+    std::shared_ptr<std::promise<std::shared_ptr<Entry>>> loader;
+    std::shared_future<std::shared_ptr<Entry>> loading;
+    std::string cacheDir;
+    {
+        std::lock_guard<std::mutex> lock(sLock);
+        Slot &slot = sEntries[key];
+        std::shared_ptr<Entry> entry = slot.entry.lock();
+        if (entry)
+        {
+            return entry;
+        }
+        if (slot.loading.valid())
+        {
+            loading = slot.loading;
+        }
+        else
+        {
+            loader = std::make_shared<std::promise<std::shared_ptr<Entry>>>();
+            slot.loading = loader->get_future().share();
+        }
+        cacheDir = sCacheDir;
+    }
+    if (!loader)
+    {
+        // Rethrows the loading exception, if any
+        return loading.get();
+    }
+
+    std::shared_ptr<Entry> entry;
+    try
+    {
+        entry = std::make_shared<Entry>();
+        entry->network = GetCore().ReadNetwork(modelPath);
+        if (setup)
+        {
+            setup(entry->network);
+        }
+        if (!ImportCached(*entry, modelPath, device, key, cacheDir, config))
+        {
+            entry->executableNetwork = GetCore().LoadNetwork(entry->network, device, config);
+            ExportCached(*entry, cacheDir);
+        }
+    }
+    catch (...)
+    {
+        {
+            // The next caller of the key tries again
+            std::lock_guard<std::mutex> lock(sLock);
+            sEntries[key].loading = std::shared_future<std::shared_ptr<Entry>>();
+        }
+        loader->set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sLock);
+        Slot &slot = sEntries[key];
+        slot.entry = entry;
+        slot.loading = std::shared_future<std::shared_ptr<Entry>>();
+    }
+    loader->set_value(entry);
+    return entry;
+}
+
+bool InferNetworkRegistry::ImportCached(Entry &entry, const std::string &modelPath, const std::string &device,
+    const std::string &key, const std::string &cacheDir, const std::map<std::string, std::string> &config)
+{
+    if (cacheDir.empty())
+    {
+        return false;
+    }
+
+    // The compiled network depends on the IR content, the setup, the device and the plugin version
+    uint64_t hash = FNV_OFFSET_BASIS;
+    std::string binPath = modelPath.substr(0, modelPath.rfind('.')) + ".bin";
+    if (!HashFile(hash, modelPath) || !HashFile(hash, binPath))
+    {
+        return false;
+    }
+    HashString(hash, key);
+    try
+    {
+        std::map<std::string, Version> versions = GetCore().GetVersions(device);
+        for (auto it = versions.begin(); it != versions.end(); ++it)
+        {
+            HashString(hash, it->first);
+            HashString(hash, it->second.buildNumber ? it->second.buildNumber : "");
+        }
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+
+    std::ostringstream name;
+    name << cacheDir;
+    if (cacheDir.back() != '/' && cacheDir.back() != '\\')
+    {
+        name << '/';
+    }
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".blob";
+    entry.cacheFile = name.str();
+
+    std::ifstream blob(entry.cacheFile, std::ios::binary);
+    if (!blob)
+    {
+        return false;
+    }
+    try
+    {
+        entry.executableNetwork = GetCore().ImportNetwork(blob, device, config);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Compiled network cache " << entry.cacheFile << " can't be imported, compiling " << modelPath
+            << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void InferNetworkRegistry::ExportCached(Entry &entry, const std::string &cacheDir)
+{
+    if (cacheDir.empty() || entry.cacheFile.empty())
+    {
+        return;
+    }
+
+    // Export to a temporary file first, so a concurrent process never imports a partial file
+    std::string tmpFile = entry.cacheFile + ".tmp";
+    try
+    {
+        entry.executableNetwork.Export(tmpFile);
+    }
+    catch (const std::exception &)
+    {
+        // Not all the plugins can export a compiled network
+        std::remove(tmpFile.c_str());
+        return;
+    }
+    std::remove(entry.cacheFile.c_str());
+    if (0 != std::rename(tmpFile.c_str(), entry.cacheFile.c_str()))
+    {
+        std::remove(tmpFile.c_str());
+    }
+}
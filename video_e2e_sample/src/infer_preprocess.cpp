@@ -0,0 +1,519 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define INFER_TARGET_AVX2
+#define INFER_TARGET_AVX512
+#else
+#include <cpuid.h>
+#define INFER_TARGET_AVX2 __attribute__((target("avx2")))
+#define INFER_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+#include "infer_preprocess.h"
+
+/*
+ * Fixed-point bilinear interpolation with 11-bit weights, the same scheme as cv::resize() uses
+ * for 8-bit images. Every instruction set computes exactly the same integer expression:
+ *   h = (p0 << 11) + (p1 - p0) * alpha       for the top and the bottom source row
+ *   v = ((ht << 11) + (hb - ht) * beta + (1 << 21)) >> 22
+ * so the results don't depend on the CPU the sample runs on. NV12 interpolates the luma and
+ * the chroma to 8 bits first and converts them with the 20-bit BT.601 coefficients of OpenCV.
+ */
+namespace
+{
+const int COEF_BITS = 11;
+const int COEF_ONE = 1 << COEF_BITS;
+const int ROUND = 1 << (2 * COEF_BITS - 1);
+
+const int YUV_SHIFT = 20;
+const int YUV_ROUND = 1 << (YUV_SHIFT - 1);
+const int YUV_CY = 1220542;
+const int YUV_CUB = 2116026;
+const int YUV_CUG = -409993;
+const int YUV_CVG = -852492;
+const int YUV_CVR = 1673527;
+
+/* Source columns and weights of each destination column */
+struct ColumnTable
+{
+    int srcWidth = 0;
+    int dstWidth = 0;
+    std::vector<int> x0;
+    std::vector<int> x1;
+    std::vector<int> alpha;
+    // The SIMD code reads 4 bytes at each source column, which must stay within the row for the
+    // planes with 1 and 2 bytes per pixel. These are the number of leading columns where it does
+    int gatherEnd1 = 0;
+    int gatherEnd2 = 0;
+};
+
+void Coordinate(int dst, double scale, int srcSize, int &src0, int &src1, int &weight)
+{
+    float f = (float)((dst + 0.5) * scale - 0.5);
+    int s = (int)std::floor(f);
+    f -= s;
+    if (s < 0)
+    {
+        s = 0;
+        f = 0;
+    }
+    if (s >= srcSize - 1)
+    {
+        s = srcSize - 1;
+        f = 0;
+    }
+    src0 = s;
+    src1 = std::min(s + 1, srcSize - 1);
+    weight = (int)(f * COEF_ONE + 0.5f);
+}
+
+/* NV12 uses one table for the luma and one for the chroma, each has its own cache entry */
+enum TableCache { TableCacheMain, TableCacheChroma, TableCacheCount };
+
+const ColumnTable &GetColumnTable(int srcWidth, int dstWidth, TableCache cache)
+{
+    // The sessions keep their frame and network sizes, the tables are only rebuilt when they change
+    thread_local ColumnTable tables[TableCacheCount];
+    ColumnTable &table = tables[cache];
+    if (table.srcWidth != srcWidth || table.dstWidth != dstWidth)
+    {
+        table.x0.resize(dstWidth);
+        table.x1.resize(dstWidth);
+        table.alpha.resize(dstWidth);
+        table.gatherEnd1 = 0;
+        table.gatherEnd2 = 0;
+        double scale = (double)srcWidth / dstWidth;
+        for (int x = 0; x < dstWidth; x++)
+        {
+            Coordinate(x, scale, srcWidth, table.x0[x], table.x1[x], table.alpha[x]);
+            if (table.x1[x] + 4 <= srcWidth)
+                table.gatherEnd1 = x + 1;
+            if (table.x1[x] + 2 <= srcWidth)
+                table.gatherEnd2 = x + 1;
+        }
+        table.srcWidth = srcWidth;
+        table.dstWidth = dstWidth;
+    }
+    return table;
+}
+
+inline int Interpolate(int tl, int tr, int bl, int br, int alpha, int beta)
+{
+    int ht = (tl << COEF_BITS) + (tr - tl) * alpha;
+    int hb = (bl << COEF_BITS) + (br - bl) * alpha;
+    return ((ht << COEF_BITS) + (hb - ht) * beta + ROUND) >> (2 * COEF_BITS);
+}
+
+inline uint8_t ClampToByte(int v)
+{
+    return (uint8_t)std::min(std::max(v, 0), 255);
+}
+
+/* Row arguments: the two source rows, the vertical weight and the destination rows of the planes */
+struct Row
+{
+    const uint8_t *top;
+    const uint8_t *bottom;
+    int beta;
+    // The chroma rows of NV12
+    const uint8_t *topUV;
+    const uint8_t *bottomUV;
+    int betaUV;
+    uint8_t *dst[3];
+};
+
+void ResizeRowScalar(const Row &row, const ColumnTable &table, int begin, int end)
+{
+    for (int x = begin; x < end; x++)
+    {
+        const uint8_t *tl = row.top + table.x0[x] * 4;
+        const uint8_t *tr = row.top + table.x1[x] * 4;
+        const uint8_t *bl = row.bottom + table.x0[x] * 4;
+        const uint8_t *br = row.bottom + table.x1[x] * 4;
+        for (int c = 0; c < 3; c++)
+        {
+            // COLOR_RGBA2BGR: plane c comes from byte 2 - c of the pixel
+            int b = 2 - c;
+            row.dst[c][x] = (uint8_t)Interpolate(tl[b], tr[b], bl[b], br[b], table.alpha[x], row.beta);
+        }
+    }
+}
+
+void ResizeRowNV12Scalar(const Row &row, const ColumnTable &luma, const ColumnTable &chroma, int begin, int end)
+{
+    for (int x = begin; x < end; x++)
+    {
+        int l0 = luma.x0[x];
+        int l1 = luma.x1[x];
+        int y = Interpolate(row.top[l0], row.top[l1], row.bottom[l0], row.bottom[l1], luma.alpha[x], row.beta);
+        int c0 = chroma.x0[x] * 2;
+        int c1 = chroma.x1[x] * 2;
+        int u = Interpolate(row.topUV[c0], row.topUV[c1], row.bottomUV[c0], row.bottomUV[c1],
+            chroma.alpha[x], row.betaUV);
+        int v = Interpolate(row.topUV[c0 + 1], row.topUV[c1 + 1], row.bottomUV[c0 + 1], row.bottomUV[c1 + 1],
+            chroma.alpha[x], row.betaUV);
+
+        int cy = std::max(y - 16, 0) * YUV_CY;
+        u -= 128;
+        v -= 128;
+        // The planes of the RGB4 path: byte 2 (R), 1 (G) and 0 (B) of the RGB4 pixel
+        row.dst[0][x] = ClampToByte((cy + YUV_CVR * v + YUV_ROUND) >> YUV_SHIFT);
+        row.dst[1][x] = ClampToByte((cy + YUV_CVG * v + YUV_CUG * u + YUV_ROUND) >> YUV_SHIFT);
+        row.dst[2][x] = ClampToByte((cy + YUV_CUB * u + YUV_ROUND) >> YUV_SHIFT);
+    }
+}
+
+template <int Byte>
+INFER_TARGET_AVX2 inline __m256i InterpolateAVX2(__m256i tl, __m256i tr, __m256i bl, __m256i br,
+    __m256i alpha, __m256i beta)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i t0 = _mm256_and_si256(_mm256_srli_epi32(tl, 8 * Byte), mask);
+    __m256i t1 = _mm256_and_si256(_mm256_srli_epi32(tr, 8 * Byte), mask);
+    __m256i b0 = _mm256_and_si256(_mm256_srli_epi32(bl, 8 * Byte), mask);
+    __m256i b1 = _mm256_and_si256(_mm256_srli_epi32(br, 8 * Byte), mask);
+    __m256i ht = _mm256_add_epi32(_mm256_slli_epi32(t0, COEF_BITS), _mm256_mullo_epi32(_mm256_sub_epi32(t1, t0), alpha));
+    __m256i hb = _mm256_add_epi32(_mm256_slli_epi32(b0, COEF_BITS), _mm256_mullo_epi32(_mm256_sub_epi32(b1, b0), alpha));
+    __m256i v = _mm256_add_epi32(_mm256_slli_epi32(ht, COEF_BITS), _mm256_mullo_epi32(_mm256_sub_epi32(hb, ht), beta));
+    return _mm256_srai_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(ROUND)), 2 * COEF_BITS);
+}
+
+INFER_TARGET_AVX2 inline void Store8AVX2(uint8_t *dst, __m256i v)
+{
+    // 8 32-bit values to 8 bytes, saturated to [0, 255]
+    __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(v, v), _mm256_setzero_si256());
+    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    _mm_storel_epi64((__m128i *)dst, _mm256_castsi256_si128(packed));
+}
+
+INFER_TARGET_AVX2 void ResizeRowAVX2(const Row &row, const ColumnTable &table, int width)
+{
+    const __m256i beta = _mm256_set1_epi32(row.beta);
+    const int *top = (const int *)row.top;
+    const int *bottom = (const int *)row.bottom;
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i x0 = _mm256_loadu_si256((const __m256i *)&table.x0[x]);
+        __m256i x1 = _mm256_loadu_si256((const __m256i *)&table.x1[x]);
+        __m256i alpha = _mm256_loadu_si256((const __m256i *)&table.alpha[x]);
+        __m256i tl = _mm256_i32gather_epi32(top, x0, 4);
+        __m256i tr = _mm256_i32gather_epi32(top, x1, 4);
+        __m256i bl = _mm256_i32gather_epi32(bottom, x0, 4);
+        __m256i br = _mm256_i32gather_epi32(bottom, x1, 4);
+        Store8AVX2(row.dst[0] + x, InterpolateAVX2<2>(tl, tr, bl, br, alpha, beta));
+        Store8AVX2(row.dst[1] + x, InterpolateAVX2<1>(tl, tr, bl, br, alpha, beta));
+        Store8AVX2(row.dst[2] + x, InterpolateAVX2<0>(tl, tr, bl, br, alpha, beta));
+    }
+    ResizeRowScalar(row, table, x, width);
+}
+
+INFER_TARGET_AVX2 void ResizeRowNV12AVX2(const Row &row, const ColumnTable &luma, const ColumnTable &chroma, int width)
+{
+    const __m256i beta = _mm256_set1_epi32(row.beta);
+    const __m256i betaUV = _mm256_set1_epi32(row.betaUV);
+    const __m256i bias = _mm256_set1_epi32(128);
+    const int *top = (const int *)row.top;
+    const int *bottom = (const int *)row.bottom;
+    const int *topUV = (const int *)row.topUV;
+    const int *bottomUV = (const int *)row.bottomUV;
+    const int end = std::min(luma.gatherEnd1, chroma.gatherEnd2);
+    int x = 0;
+    for (; x + 8 <= end; x += 8)
+    {
+        __m256i x0 = _mm256_loadu_si256((const __m256i *)&luma.x0[x]);
+        __m256i x1 = _mm256_loadu_si256((const __m256i *)&luma.x1[x]);
+        __m256i alpha = _mm256_loadu_si256((const __m256i *)&luma.alpha[x]);
+        __m256i y = InterpolateAVX2<0>(_mm256_i32gather_epi32(top, x0, 1), _mm256_i32gather_epi32(top, x1, 1),
+            _mm256_i32gather_epi32(bottom, x0, 1), _mm256_i32gather_epi32(bottom, x1, 1), alpha, beta);
+
+        x0 = _mm256_loadu_si256((const __m256i *)&chroma.x0[x]);
+        x1 = _mm256_loadu_si256((const __m256i *)&chroma.x1[x]);
+        alpha = _mm256_loadu_si256((const __m256i *)&chroma.alpha[x]);
+        __m256i tl = _mm256_i32gather_epi32(topUV, x0, 2);
+        __m256i tr = _mm256_i32gather_epi32(topUV, x1, 2);
+        __m256i bl = _mm256_i32gather_epi32(bottomUV, x0, 2);
+        __m256i br = _mm256_i32gather_epi32(bottomUV, x1, 2);
+        __m256i u = _mm256_sub_epi32(InterpolateAVX2<0>(tl, tr, bl, br, alpha, betaUV), bias);
+        __m256i v = _mm256_sub_epi32(InterpolateAVX2<1>(tl, tr, bl, br, alpha, betaUV), bias);
+
+        __m256i cy = _mm256_mullo_epi32(_mm256_max_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(16)),
+            _mm256_setzero_si256()), _mm256_set1_epi32(YUV_CY));
+        cy = _mm256_add_epi32(cy, _mm256_set1_epi32(YUV_ROUND));
+        __m256i r = _mm256_add_epi32(cy, _mm256_mullo_epi32(v, _mm256_set1_epi32(YUV_CVR)));
+        __m256i g = _mm256_add_epi32(cy, _mm256_add_epi32(_mm256_mullo_epi32(v, _mm256_set1_epi32(YUV_CVG)),
+            _mm256_mullo_epi32(u, _mm256_set1_epi32(YUV_CUG))));
+        __m256i b = _mm256_add_epi32(cy, _mm256_mullo_epi32(u, _mm256_set1_epi32(YUV_CUB)));
+        Store8AVX2(row.dst[0] + x, _mm256_srai_epi32(r, YUV_SHIFT));
+        Store8AVX2(row.dst[1] + x, _mm256_srai_epi32(g, YUV_SHIFT));
+        Store8AVX2(row.dst[2] + x, _mm256_srai_epi32(b, YUV_SHIFT));
+    }
+    ResizeRowNV12Scalar(row, luma, chroma, x, width);
+}
+
+template <int Byte>
+INFER_TARGET_AVX512 inline __m512i InterpolateAVX512(__m512i tl, __m512i tr, __m512i bl, __m512i br,
+    __m512i alpha, __m512i beta)
+{
+    const __m512i mask = _mm512_set1_epi32(0xFF);
+    __m512i t0 = _mm512_and_si512(_mm512_srli_epi32(tl, 8 * Byte), mask);
+    __m512i t1 = _mm512_and_si512(_mm512_srli_epi32(tr, 8 * Byte), mask);
+    __m512i b0 = _mm512_and_si512(_mm512_srli_epi32(bl, 8 * Byte), mask);
+    __m512i b1 = _mm512_and_si512(_mm512_srli_epi32(br, 8 * Byte), mask);
+    __m512i ht = _mm512_add_epi32(_mm512_slli_epi32(t0, COEF_BITS), _mm512_mullo_epi32(_mm512_sub_epi32(t1, t0), alpha));
+    __m512i hb = _mm512_add_epi32(_mm512_slli_epi32(b0, COEF_BITS), _mm512_mullo_epi32(_mm512_sub_epi32(b1, b0), alpha));
+    __m512i v = _mm512_add_epi32(_mm512_slli_epi32(ht, COEF_BITS), _mm512_mullo_epi32(_mm512_sub_epi32(hb, ht), beta));
+    return _mm512_srai_epi32(_mm512_add_epi32(v, _mm512_set1_epi32(ROUND)), 2 * COEF_BITS);
+}
+
+INFER_TARGET_AVX512 inline void Store16AVX512(uint8_t *dst, __m512i v)
+{
+    _mm_storeu_si128((__m128i *)dst, _mm512_cvtusepi32_epi8(_mm512_max_epi32(v, _mm512_setzero_si512())));
+}
+
+INFER_TARGET_AVX512 void ResizeRowAVX512(const Row &row, const ColumnTable &table, int width)
+{
+    const __m512i beta = _mm512_set1_epi32(row.beta);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m512i x0 = _mm512_loadu_si512(&table.x0[x]);
+        __m512i x1 = _mm512_loadu_si512(&table.x1[x]);
+        __m512i alpha = _mm512_loadu_si512(&table.alpha[x]);
+        __m512i tl = _mm512_i32gather_epi32(x0, row.top, 4);
+        __m512i tr = _mm512_i32gather_epi32(x1, row.top, 4);
+        __m512i bl = _mm512_i32gather_epi32(x0, row.bottom, 4);
+        __m512i br = _mm512_i32gather_epi32(x1, row.bottom, 4);
+        Store16AVX512(row.dst[0] + x, InterpolateAVX512<2>(tl, tr, bl, br, alpha, beta));
+        Store16AVX512(row.dst[1] + x, InterpolateAVX512<1>(tl, tr, bl, br, alpha, beta));
+        Store16AVX512(row.dst[2] + x, InterpolateAVX512<0>(tl, tr, bl, br, alpha, beta));
+    }
+    ResizeRowScalar(row, table, x, width);
+}
+
+INFER_TARGET_AVX512 void ResizeRowNV12AVX512(const Row &row, const ColumnTable &luma, const ColumnTable &chroma, int width)
+{
+    const __m512i beta = _mm512_set1_epi32(row.beta);
+    const __m512i betaUV = _mm512_set1_epi32(row.betaUV);
+    const __m512i bias = _mm512_set1_epi32(128);
+    const int end = std::min(luma.gatherEnd1, chroma.gatherEnd2);
+    int x = 0;
+    for (; x + 16 <= end; x += 16)
+    {
+        __m512i x0 = _mm512_loadu_si512(&luma.x0[x]);
+        __m512i x1 = _mm512_loadu_si512(&luma.x1[x]);
+        __m512i alpha = _mm512_loadu_si512(&luma.alpha[x]);
+        __m512i y = InterpolateAVX512<0>(_mm512_i32gather_epi32(x0, row.top, 1), _mm512_i32gather_epi32(x1, row.top, 1),
+            _mm512_i32gather_epi32(x0, row.bottom, 1), _mm512_i32gather_epi32(x1, row.bottom, 1), alpha, beta);
+
+        x0 = _mm512_loadu_si512(&chroma.x0[x]);
+        x1 = _mm512_loadu_si512(&chroma.x1[x]);
+        alpha = _mm512_loadu_si512(&chroma.alpha[x]);
+        __m512i tl = _mm512_i32gather_epi32(x0, row.topUV, 2);
+        __m512i tr = _mm512_i32gather_epi32(x1, row.topUV, 2);
+        __m512i bl = _mm512_i32gather_epi32(x0, row.bottomUV, 2);
+        __m512i br = _mm512_i32gather_epi32(x1, row.bottomUV, 2);
+        __m512i u = _mm512_sub_epi32(InterpolateAVX512<0>(tl, tr, bl, br, alpha, betaUV), bias);
+        __m512i v = _mm512_sub_epi32(InterpolateAVX512<1>(tl, tr, bl, br, alpha, betaUV), bias);
+
+        __m512i cy = _mm512_mullo_epi32(_mm512_max_epi32(_mm512_sub_epi32(y, _mm512_set1_epi32(16)),
+            _mm512_setzero_si512()), _mm512_set1_epi32(YUV_CY));
+        cy = _mm512_add_epi32(cy, _mm512_set1_epi32(YUV_ROUND));
+        __m512i r = _mm512_add_epi32(cy, _mm512_mullo_epi32(v, _mm512_set1_epi32(YUV_CVR)));
+        __m512i g = _mm512_add_epi32(cy, _mm512_add_epi32(_mm512_mullo_epi32(v, _mm512_set1_epi32(YUV_CVG)),
+            _mm512_mullo_epi32(u, _mm512_set1_epi32(YUV_CUG))));
+        __m512i b = _mm512_add_epi32(cy, _mm512_mullo_epi32(u, _mm512_set1_epi32(YUV_CUB)));
+        Store16AVX512(row.dst[0] + x, _mm512_srai_epi32(r, YUV_SHIFT));
+        Store16AVX512(row.dst[1] + x, _mm512_srai_epi32(g, YUV_SHIFT));
+        Store16AVX512(row.dst[2] + x, _mm512_srai_epi32(b, YUV_SHIFT));
+    }
+    ResizeRowNV12Scalar(row, luma, chroma, x, width);
+}
+
+void CpuId(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int *)regs, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+unsigned long long XGetBV()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+InferPreprocess::Isa DetectIsa()
+{
+    unsigned int regs[4];
+    CpuId(0, 0, regs);
+    if (regs[0] < 7)
+        return InferPreprocess::IsaScalar;
+
+    CpuId(1, 0, regs);
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const bool avx = (regs[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx)
+        return InferPreprocess::IsaScalar;
+
+    // The OS must save the YMM and, for AVX-512, the opmask and ZMM registers
+    unsigned long long xcr0 = XGetBV();
+    CpuId(7, 0, regs);
+    if ((regs[1] & (1u << 16)) && (xcr0 & 0xE6) == 0xE6)
+        return InferPreprocess::IsaAVX512;
+    if ((regs[1] & (1u << 5)) && (xcr0 & 0x6) == 0x6)
+        return InferPreprocess::IsaAVX2;
+    return InferPreprocess::IsaScalar;
+}
+}
+
+InferPreprocess::Isa InferPreprocess::SupportedIsa()
+{
+    static const Isa isa = DetectIsa();
+    return isa;
+}
+
+void InferPreprocess::ResizeToPlanarBGR(const Frame &src, uint8_t *dst, int dstWidth, int dstHeight,
+    size_t dstStride, size_t planeStride)
+{
+    ResizeToPlanarBGR(SupportedIsa(), src, dst, dstWidth, dstHeight, dstStride, planeStride);
+}
+
+InferPreprocess::Frame InferPreprocess::Frame::Roi(int x, int y, int w, int h) const
+{
+    Frame roi = *this;
+    if (format == FormatNV12)
+    {
+        x &= ~1;
+        y &= ~1;
+        roi.data = data + (size_t)y * pitch + x;
+        roi.uv = uv + (size_t)(y / 2) * pitch + x;
+    }
+    else
+    {
+        roi.data = data + (size_t)y * pitch + (size_t)x * 4;
+    }
+    roi.width = w;
+    roi.height = h;
+    return roi;
+}
+
+InferPreprocess::Frame InferPreprocess::Copy(const Frame &src, std::vector<uint8_t> &storage)
+{
+    Frame copy = src;
+    if (src.format == FormatNV12)
+    {
+        const int chromaHeight = (src.height + 1) / 2;
+        copy.pitch = (src.width + 1) & ~1;
+        storage.resize((size_t)copy.pitch * (src.height + chromaHeight));
+        for (int y = 0; y < src.height; y++)
+        {
+            memcpy(&storage[(size_t)y * copy.pitch], src.data + (size_t)y * src.pitch, copy.pitch);
+        }
+        for (int y = 0; y < chromaHeight; y++)
+        {
+            memcpy(&storage[(size_t)(src.height + y) * copy.pitch], src.uv + (size_t)y * src.pitch, copy.pitch);
+        }
+        copy.data = storage.data();
+        copy.uv = storage.data() + (size_t)src.height * copy.pitch;
+    }
+    else
+    {
+        copy.pitch = src.width * 4;
+        storage.resize((size_t)copy.pitch * src.height);
+        for (int y = 0; y < src.height; y++)
+        {
+            memcpy(&storage[(size_t)y * copy.pitch], src.data + (size_t)y * src.pitch, copy.pitch);
+        }
+        copy.data = storage.data();
+    }
+    return copy;
+}
+
+void InferPreprocess::ResizeToPlanarBGR(Isa isa, const Frame &src, uint8_t *dst, int dstWidth, int dstHeight,
+    size_t dstStride, size_t planeStride)
+{
+    if (src.width <= 0 || src.height <= 0 || dstWidth <= 0 || dstHeight <= 0)
+        return;
+
+    const bool nv12 = (src.format == FormatNV12);
+    const ColumnTable &table = GetColumnTable(src.width, dstWidth, TableCacheMain);
+    const int chromaWidth = (src.width + 1) / 2;
+    const int chromaHeight = (src.height + 1) / 2;
+    const ColumnTable *chroma = nv12 ? &GetColumnTable(chromaWidth, dstWidth, TableCacheChroma) : NULL;
+    const double scale = (double)src.height / dstHeight;
+    const double chromaScale = (double)chromaHeight / dstHeight;
+    for (int y = 0; y < dstHeight; y++)
+    {
+        int y0, y1;
+        Row row;
+        Coordinate(y, scale, src.height, y0, y1, row.beta);
+        row.top = src.data + (size_t)y0 * src.pitch;
+        row.bottom = src.data + (size_t)y1 * src.pitch;
+        for (int c = 0; c < 3; c++)
+        {
+            row.dst[c] = dst + c * planeStride + y * dstStride;
+        }
+
+        if (nv12)
+        {
+            Coordinate(y, chromaScale, chromaHeight, y0, y1, row.betaUV);
+            row.topUV = src.uv + (size_t)y0 * src.pitch;
+            row.bottomUV = src.uv + (size_t)y1 * src.pitch;
+            switch (isa)
+            {
+            case IsaAVX512:
+                ResizeRowNV12AVX512(row, table, *chroma, dstWidth);
+                break;
+            case IsaAVX2:
+                ResizeRowNV12AVX2(row, table, *chroma, dstWidth);
+                break;
+            default:
+                ResizeRowNV12Scalar(row, table, *chroma, 0, dstWidth);
+                break;
+            }
+            continue;
+        }
+
+        switch (isa)
+        {
+        case IsaAVX512:
+            ResizeRowAVX512(row, table, dstWidth);
+            break;
+        case IsaAVX2:
+            ResizeRowAVX2(row, table, dstWidth);
+            break;
+        default:
+            ResizeRowScalar(row, table, 0, dstWidth);
+            break;
+        }
+    }
+}
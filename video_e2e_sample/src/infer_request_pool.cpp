@@ -0,0 +1,160 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include <iostream>
+
+#include "infer_request_pool.h"
+
+using namespace InferenceEngine;
+
+InferRequestPool::InferRequestPool() :
+    mLatencyMs(0)
+{
+}
+
+InferRequestPool::~InferRequestPool()
+{
+    WaitAll();
+}
+
+void InferRequestPool::Init(ExecutableNetwork &network, int depth)
+{
+    WaitAll();
+    mSlots.clear();
+    mSlots.resize(depth > 0 ? depth : 1);
+
+    for (size_t i = 0; i < mSlots.size(); i++)
+    {
+        mSlots[i].request = network.CreateInferRequest();
+        mSlots[i].busy = false;
+        mSlots[i].held = false;
+        mSlots[i].handling = false;
+        mSlots[i].request.SetCompletionCallback(
+            std::function<void(InferRequest, StatusCode)>([this, i](InferRequest, StatusCode status) {
+                OnComplete(i, status);
+            }));
+    }
+}
+
+size_t InferRequestPool::Acquire()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    for (;;)
+    {
+        for (size_t i = 0; i < mSlots.size(); i++)
+        {
+            if (!mSlots[i].busy)
+            {
+                mSlots[i].busy = true;
+                return i;
+            }
+        }
+        mCond.wait(lock);
+    }
+}
+
+void InferRequestPool::StartAsync(size_t slot, const CompletionHandler &done)
+{
+    mSlots[slot].done = done;
+    mSlots[slot].started = std::chrono::steady_clock::now();
+    try
+    {
+        mSlots[slot].request.StartAsync();
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mSlots[slot].busy = false;
+        }
+        mCond.notify_all();
+        throw;
+    }
+}
+
+void InferRequestPool::OnComplete(size_t slot, StatusCode status)
+{
+    Slot &s = mSlots[slot];
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        s.handling = true;
+    }
+    if (StatusCode::OK == status && s.done)
+    {
+        try
+        {
+            s.done(s.request, slot);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[ ERROR ] Inference results handling failed: " << e.what() << std::endl;
+        }
+    }
+    else if (StatusCode::OK != status)
+    {
+        std::cerr << "[ ERROR ] Inference request failed with status " << status << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        s.done = nullptr;
+        s.handling = false;
+        s.busy = s.held;
+        if (!s.busy)
+            Done(s);
+    }
+    mCond.notify_all();
+}
+
+void InferRequestPool::Hold(size_t slot)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mSlots[slot].held = true;
+}
+
+void InferRequestPool::Release(size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mSlots[slot].held = false;
+        mSlots[slot].busy = mSlots[slot].handling;
+        if (!mSlots[slot].busy)
+            Done(mSlots[slot]);
+    }
+    mCond.notify_all();
+}
+
+void InferRequestPool::Done(Slot &slot)
+{
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.started).count();
+    const double latency = mLatencyMs;
+    mLatencyMs = (latency > 0) ? latency + (ms - latency) / 8 : ms;
+}
+
+void InferRequestPool::WaitAll()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    mCond.wait(lock, [this] {
+        for (size_t i = 0; i < mSlots.size(); i++)
+        {
+            if (mSlots[i].busy)
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+}
@@ -0,0 +1,217 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include <algorithm>
+
+#include "infer_server.h"
+
+using namespace InferenceEngine;
+
+std::mutex InferServer::sServersLock;
+std::map<std::string, std::weak_ptr<InferServer>> InferServer::sServers;
+
+std::shared_ptr<InferServer> InferServer::Get(const std::string &modelPath, const std::string &device,
+    const std::string &tag, int maxBatch, int maxWaitMs, const NetworkSetup &setup, bool mosaic)
+{
+    // Sessions with a different batch timeout get their own server instead of the timeout of
+    // whichever session created it
+    std::string key = modelPath + "|" + device + "|" + tag + "|" + std::to_string(maxBatch) + "|" +
+        std::to_string(std::max(maxWaitMs, 0)) + (mosaic ? "|mosaic" : "");
+    std::shared_ptr<InferServer> server;
+    {
+        std::lock_guard<std::mutex> lock(sServersLock);
+        server = sServers[key].lock();
+    }
+    if (!server)
+    {
+        // Load without holding the lock so that servers of different models load in parallel.
+        // The registry loads the network once even if two sessions get here at the same time
+        std::shared_ptr<InferServer> loaded(new InferServer(tag, maxBatch, maxWaitMs, mosaic));
+        loaded->Load(modelPath, device, setup);
+
+        std::lock_guard<std::mutex> lock(sServersLock);
+        server = sServers[key].lock();
+        if (!server)
+        {
+            server = loaded;
+            server->mThread = std::thread(&InferServer::Run, server.get());
+            sServers[key] = server;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(server->mLock);
+        server->mClients++;
+    }
+    // The handle keeps the server alive and detaches the session when it's released
+    return std::shared_ptr<InferServer>(server.get(), [server](InferServer *) { server->Detach(); });
+}
+
+InferServer::InferServer(const std::string &tag, int maxBatch, int maxWaitMs, bool mosaic):
+    mTag(tag),
+    mMaxBatch(std::max(maxBatch, 1)),
+    mMaxWait(std::max(maxWaitMs, 0)),
+    mDynBatch(false),
+    mMosaic(mosaic),
+    mClients(0),
+    mStop(false)
+{
+}
+
+InferServer::~InferServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStop = true;
+    }
+    mCond.notify_all();
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+void InferServer::Load(const std::string &modelPath, const std::string &device, const NetworkSetup &setup)
+{
+    int maxBatch = mMosaic ? 1 : mMaxBatch;
+    NetworkSetup batchSetup = [setup, maxBatch](CNNNetwork &network) {
+        if (setup)
+        {
+            setup(network);
+        }
+        network.setBatchSize(maxBatch);
+    };
+    std::string setupTag = mTag + "|batch" + std::to_string(maxBatch);
+
+    if (maxBatch > 1)
+    {
+        try
+        {
+            mNetwork = InferNetworkRegistry::Load(modelPath, device, setupTag, batchSetup,
+                {{PluginConfigParams::KEY_DYN_BATCH_ENABLED, PluginConfigParams::YES}});
+            mDynBatch = true;
+        }
+        catch (const std::exception &)
+        {
+            // Not every plugin or topology supports dynamic batch, partial batches then run at full size
+            mDynBatch = false;
+        }
+    }
+    if (!mDynBatch)
+    {
+        mNetwork = InferNetworkRegistry::Load(modelPath, device, setupTag, batchSetup);
+    }
+    mInputName = mNetwork->network.getInputsInfo().begin()->first;
+    mRequest = mNetwork->executableNetwork.CreateInferRequest();
+}
+
+void InferServer::Detach()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mClients--;
+    }
+    // The pending frames may now be all the frames we are waiting for
+    mCond.notify_all();
+}
+
+void InferServer::Infer(const InputFiller &fill, const ResultHandler &handle)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->fill = fill;
+    job->handle = handle;
+    job->queued = std::chrono::steady_clock::now();
+    std::future<void> done = job->done.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPending.push_back(job);
+    }
+    mCond.notify_all();
+
+    // Rethrows the inference exception, if any
+    done.get();
+}
+
+void InferServer::Run()
+{
+    std::vector<std::shared_ptr<Job>> batch;
+    batch.reserve(mMaxBatch);
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mCond.wait(lock, [this] { return mStop || !mPending.empty(); });
+            if (mPending.empty())
+            {
+                return;
+            }
+
+            // Each session has at most one frame in flight, so once every session has
+            // submitted there is nothing more to wait for
+            std::chrono::steady_clock::time_point deadline = mPending.front()->queued + mMaxWait;
+            mCond.wait_until(lock, deadline, [this] {
+                return mStop || mPending.size() >= (size_t)mMaxBatch || (int)mPending.size() >= mClients;
+            });
+
+            size_t num = std::min(mPending.size(), (size_t)mMaxBatch);
+            batch.assign(mPending.begin(), mPending.begin() + num);
+            mPending.erase(mPending.begin(), mPending.begin() + num);
+        }
+
+        RunBatch(batch);
+        batch.clear();
+    }
+}
+
+void InferServer::RunBatch(std::vector<std::shared_ptr<Job>> &batch)
+{
+    size_t handled = 0;
+    try
+    {
+        if (mDynBatch)
+        {
+            mRequest.SetBatch((int)batch.size());
+        }
+
+        Blob::Ptr input = mRequest.GetBlob(mInputName);
+        if (mMosaic)
+        {
+            // The parts of the sessions which didn't submit a frame stay black
+            std::fill_n(input->buffer().as<uint8_t *>(), input->byteSize(), 0);
+        }
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            batch[i]->fill(input, mMosaic ? 0 : i);
+        }
+
+        mRequest.Infer();
+
+        for (; handled < batch.size(); handled++)
+        {
+            batch[handled]->handle(mRequest, mMosaic ? 0 : handled);
+            batch[handled]->done.set_value();
+        }
+    }
+    catch (...)
+    {
+        for (; handled < batch.size(); handled++)
+        {
+            batch[handled]->done.set_exception(std::current_exception());
+        }
+    }
+}
@@ -19,10 +19,13 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 
 #include "sample_utils.h"
 #include "media_inference_manager.h"
+#include "infer_network_registry.h"
 
 #include "human_pose_estimator.hpp"
-#include "render_human_pose.hpp"
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <exception>
 
 #define FDUMP 0
 #define LESS_P 1
@@ -34,21 +37,145 @@ using namespace std;
 
 MediaInferenceManager::MediaInferenceManager():
     mInferType(0),
-    mInferInterval(5),
+    mCropX(0),
+    mCropY(0),
+    mMaxObjNum(-1),
     mTargetDevice("GPU"),
-    mMaxObjNum(-1)
+    mInferInterval(5),
+    mMaxBatch(1),
+    mMaxBatchWaitMs(0),
+    mRequestNum(1),
+    mPreprocMode(InferPreprocess::ModeCPU),
+    mFrameFormat(InferPreprocess::FormatRGB4),
+    mTracking(false),
+    mTileCols(1),
+    mTileRows(1),
+    mTileOverlap(0),
+    mMosaic(false),
+    mShareInputs(false),
+    mMotionSkipped(0),
+    mCascadeThreshold(0.5f),
+    mCascadeFrames(0),
+    mCascadeEscalated(0),
+    mCascadeUs(0),
+    mFullUs(0),
+    mPoseFullFrameInterval(0)
 {
     mInit = false;
 }
 
 MediaInferenceManager::~MediaInferenceManager()
 {
-    delete mHPEstimator;
-    mHPEstimator = nullptr;
-    delete mFaceDetector;
-    mFaceDetector = nullptr;
-    delete mVehicleDetector;
-    mVehicleDetector = nullptr;
+    delete mCascadeDetector;
+    mCascadeDetector = nullptr;
+}
+
+void MediaInferenceManager::SetBatchMode(int maxBatch, int maxWaitMs)
+{
+    mMaxBatch = maxBatch;
+    mMaxBatchWaitMs = maxWaitMs;
+}
+
+void MediaInferenceManager::SetRequestNum(int num)
+{
+    mRequestNum = num;
+}
+
+void MediaInferenceManager::SetPreprocessMode(InferPreprocess::Mode mode)
+{
+    mPreprocMode = mode;
+}
+
+void MediaInferenceManager::SetFrameFormat(InferPreprocess::Format format)
+{
+    mFrameFormat = format;
+}
+
+void MediaInferenceManager::SetTracking(bool enable)
+{
+    mTracking = enable;
+}
+
+void MediaInferenceManager::SetMotionThreshold(float threshold)
+{
+    mMotionGate.SetThreshold(threshold);
+}
+
+void MediaInferenceManager::SetRois(const std::vector<cv::Rect> &rois)
+{
+    mRois = rois;
+}
+
+void MediaInferenceManager::SetTiles(int cols, int rows, float overlap)
+{
+    mTileCols = cols;
+    mTileRows = rows;
+    mTileOverlap = overlap;
+}
+
+void MediaInferenceManager::SetMosaic(const cv::Rect &tile, const cv::Size &mosaicSize)
+{
+    mMosaic = tile.area() > 0 && mosaicSize.area() > 0;
+    if (mMosaic)
+    {
+        mMosaicTile = cv::Rect2f(static_cast<float>(tile.x) / mosaicSize.width,
+            static_cast<float>(tile.y) / mosaicSize.height,
+            static_cast<float>(tile.width) / mosaicSize.width,
+            static_cast<float>(tile.height) / mosaicSize.height);
+    }
+}
+
+void MediaInferenceManager::SetCascade(const msdk_char *modelPath, float threshold)
+{
+    mCascadeModel.clear();
+    if (modelPath && modelPath[0])
+    {
+        int iLength = WideCharToMultiByte(CP_ACP, 0, modelPath, -1, NULL, 0, NULL, NULL);
+        char local[MAX_PATH];
+        WideCharToMultiByte(CP_ACP, 0, modelPath, -1, local, iLength, NULL, NULL);
+        local[iLength] = '\0';
+        mCascadeModel = local;
+    }
+    mCascadeThreshold = threshold;
+}
+
+void MediaInferenceManager::SetHumanPoseCrops(int fullFrameInterval)
+{
+    mPoseFullFrameInterval = fullFrameInterval;
+}
+
+double MediaInferenceManager::InferLatencyMs() const
+{
+    double latency = 0;
+    for (const std::unique_ptr<InferModel> &model : mModels)
+    {
+        latency = std::max(latency, model->LatencyMs());
+    }
+    return latency;
+}
+
+MediaInferenceManager::CascadeStatistics MediaInferenceManager::GetCascadeStatistics() const
+{
+    CascadeStatistics stats;
+    stats.frames = mCascadeFrames;
+    stats.escalated = mCascadeEscalated;
+    stats.cheapMs = stats.frames ? mCascadeUs / 1000.0 / stats.frames : 0;
+    stats.fullMs = stats.escalated ? mFullUs / 1000.0 / stats.escalated : 0;
+    return stats;
+}
+
+void MediaInferenceManager::SetNetworkCacheDir(const msdk_char *dir)
+{
+    std::string cacheDir;
+    if (dir && dir[0])
+    {
+        int iLength = WideCharToMultiByte(CP_ACP, 0, dir, -1, NULL, 0, NULL, NULL);
+        char local[MAX_PATH];
+        WideCharToMultiByte(CP_ACP, 0, dir, -1, local, iLength, NULL, NULL);
+        local[iLength] = '\0';
+        cacheDir = local;
+    }
+    InferNetworkRegistry::SetCacheDir(cacheDir);
 }
 
 int MediaInferenceManager::Init(int dec_w, int dec_h, int infer_type,
@@ -56,10 +183,35 @@ int MediaInferenceManager::Init(int dec_w, int dec_h, int infer_type,
 {
     int ret = 0;
     mInferType = infer_type;
+    mInferTypes.assign(1, infer_type);
+    for (int type : mExtraInferTypes)
+    {
+        if (type != InferTypeNone && !HasInferType(type))
+        {
+            mInferTypes.push_back(type);
+        }
+    }
     mDecW = dec_w;
     mDecH = dec_h;
     mMaxObjNum = maxObjNum;
 
+    if (!mRois.empty() && HasInferType(InferTypeHumanPoseEst))
+    {
+        msdk_printf(MSDK_STRING("WARNING: human pose estimation infers the whole frame, the regions are ignored\n"));
+    }
+    if (mTileCols * mTileRows > 1 && HasInferType(InferTypeHumanPoseEst))
+    {
+        msdk_printf(MSDK_STRING("WARNING: human pose estimation infers the whole frame, the tiles are ignored\n"));
+    }
+    if (mMosaic && HasInferType(InferTypeHumanPoseEst))
+    {
+        msdk_printf(MSDK_STRING("WARNING: human pose estimation infers the whole frame, the mosaic is ignored\n"));
+    }
+    else if (mMosaic && mTileCols * mTileRows > 1)
+    {
+        msdk_printf(MSDK_STRING("WARNING: the frame is detected on tiles, the mosaic is ignored\n"));
+    }
+
     switch(device)
     {
         case InferDeviceGPU:
@@ -75,239 +227,291 @@ int MediaInferenceManager::Init(int dec_w, int dec_h, int infer_type,
             break;
     }
 
-    switch(mInferType)
+    for (size_t t = 0; t < mInferTypes.size() && ret == 0; t++)
     {
-        case InferTypeFaceDetection:
-            ret = InitFaceDetection(model_dir);
-            break;
-        case InferTypeVADetect:
-            ret = InitVehicleDetect(model_dir);
-            break;
-        case InferTypeHumanPoseEst:
-            ret = InitHumanPose(model_dir);
-            break;
-        default:
-            msdk_printf(MSDK_STRING("ERROR:Unsupported inference type %d\n"), mInferType);
-	    ret = -1;
-	    break;
+        switch(mInferTypes[t])
+        {
+            case InferTypeFaceDetection:
+                ret = InitFaceDetection(model_dir);
+                break;
+            case InferTypeVADetect:
+                ret = InitVehicleDetect(model_dir);
+                break;
+            case InferTypeHumanPoseEst:
+                ret = InitHumanPose(model_dir);
+                break;
+            default:
+                msdk_printf(MSDK_STRING("ERROR:Unsupported inference type %d\n"), mInferTypes[t]);
+                ret = -1;
+                break;
+        }
+    }
+    if (ret == 0 && !mCascadeModel.empty())
+    {
+        // One frame at a time, the escalation needs the results of the frame
+        mCascadeDetector = new FaceDetect(false);
+        mCascadeDetector->SetThreshold(mCascadeThreshold);
+        mCascadeDetector->Init(mCascadeModel, mTargetDevice, 1, 0, 1, mPreprocMode, mFrameFormat);
+    }
+    // The frame is resized once for each input size of the models, and shared by them
+    mShareInputs = (mInferTypes.size() > 1 || mCascadeDetector) && mPreprocMode == InferPreprocess::ModeCPU;
+    if (ret == 0 && mShareInputs)
+    {
+        for (std::unique_ptr<InferModel> &model : mModels)
+            model->SetInputCache(&mInputCache);
+        if (mCascadeDetector)
+            mCascadeDetector->SetInputCache(&mInputCache);
     }
     if (ret == 0)
     {
+        // The models after the first run concurrently with it, each one in a thread kept for all the frames
+        for (size_t m = 1; m < mModels.size(); m++)
+        {
+            mModelWorkers.emplace_back(new InferModelWorker(mModels[m].get()));
+        }
         mInit = true;
     }
     return ret;
 }
 
-int MediaInferenceManager::RunInfer(mfxFrameData *pData, bool inferOffline)
+int MediaInferenceManager::RunInfer(mfxFrameSurface1 *pSurface, bool inferOffline)
 {
     if (!mInit)
     {
         return -1;
     }
+    mfxFrameData *pData = &pSurface->Data;
+    mCropX = pSurface->Info.CropX;
+    mCropY = pSurface->Info.CropY;
 
-    switch(mInferType)
+    if (mMotionGate.IsEnabled() && !mMotionGate.Changed(SurfaceFrame(pData)))
     {
-        case InferTypeFaceDetection:
-            RunInferFD(pData, inferOffline);
-            break;
-        case InferTypeVADetect:
-            RunInferVDVA(pData, inferOffline);
-            break;
-        case InferTypeHumanPoseEst:
-            RunInferHP(pData, inferOffline);
-            break;
-        default:
-            msdk_printf(MSDK_STRING("ERROR:Unsupported inference type %d\n"), mInferType);
-            return -1;
+        mMotionSkipped++;
+        if (!inferOffline)
+        {
+            RenderRepeatLast(pSurface);
+        }
+        return 1;
+    }
+
+    if (mShareInputs)
+    {
+        mInputCache.Reset(SurfaceFrame(pData));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (mCascadeDetector)
+    {
+        const bool escalate = CascadeEscalates(SurfaceFrame(pData));
+        const std::chrono::steady_clock::time_point cheapDone = std::chrono::steady_clock::now();
+        mCascadeUs += std::chrono::duration_cast<std::chrono::microseconds>(cheapDone - start).count();
+        mCascadeFrames++;
+        if (!escalate)
+        {
+            // Nothing to render, and the tracks end
+            ClearResults();
+            if (mTracking)
+            {
+                CorrectTracks();
+            }
+            return 0;
+        }
+        mCascadeEscalated++;
+        start = cheapDone;
+    }
+
+    const InferPreprocess::Frame frame = SurfaceFrame(pData);
+    const std::vector<cv::Rect> regions = InferRegions();
+    if (mModels.size() == 1)
+    {
+        mModels[0]->Infer(frame, regions);
+    }
+    else
+    {
+        // The models run concurrently on the frame, and render one after another once all of them are done
+        for (std::unique_ptr<InferModelWorker> &worker : mModelWorkers)
+        {
+            worker->Start(frame, regions);
+        }
+        std::exception_ptr error;
+        try
+        {
+            mModels[0]->Infer(frame, regions);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        // All of them are waited for, they use the frame
+        for (std::unique_ptr<InferModelWorker> &worker : mModelWorkers)
+        {
+            try
+            {
+                worker->Wait();
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    if (!inferOffline)
+    {
+        FrameCanvas canvas = SurfaceCanvas(pData);
+        for (std::unique_ptr<InferModel> &model : mModels)
+        {
+            model->Render(canvas);
+        }
+    }
+    if (mCascadeDetector)
+    {
+        mFullUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (mTracking)
+    {
+        CorrectTracks();
     }
     return 0;
 }
 
-int MediaInferenceManager::RenderRepeatLast(mfxFrameData *pData)
+int MediaInferenceManager::RenderRepeatLast(mfxFrameSurface1 *pSurface)
 {
     if (!mInit)
     {
         return -1;
     }
+    mfxFrameData *pData = &pSurface->Data;
+    mCropX = pSurface->Info.CropX;
+    mCropY = pSurface->Info.CropY;
+    if (mTracking)
+    {
+        PredictTracks();
+    }
 
-    switch(mInferType)
+    FrameCanvas canvas = SurfaceCanvas(pData);
+    for (std::unique_ptr<InferModel> &model : mModels)
     {
-        case InferTypeFaceDetection:
-            RenderRepeatLastFD(pData);
-            break;
-        case InferTypeVADetect:
-            RenderRepeatLastVD(pData);
-            break;
-        case InferTypeHumanPoseEst:
-            RenderRepeatLastHP(pData);
-            break;
-        default:
-            msdk_printf(MSDK_STRING("ERROR:Unsupported inference type %d\n"), mInferType);
-            return -1;
+        model->Render(canvas);
     }
     return 0;
 }
 
-int MediaInferenceManager::RenderRepeatLastFD(mfxFrameData *pData)
+bool MediaInferenceManager::HasInferType(int type) const
 {
-    if (mFaceDetector && mFaceDetector->results.size() > 0) {
-        Mat frameRGB4(mDecH, mDecW, CV_8UC4, (unsigned char *)pData->B);
-        mFaceDetector->RenderFDResults(frameRGB4);
-    }
-    return 0;
+    return std::find(mInferTypes.begin(), mInferTypes.end(), type) != mInferTypes.end();
 }
 
-int MediaInferenceManager::RenderRepeatLastHP(mfxFrameData *pData)
+void MediaInferenceManager::SetExtraInferTypes(const std::vector<int> &types)
 {
-    if (mPoses.size() > 0) {
-        Mat frameRGB4(mDecH, mDecW, CV_8UC4, (unsigned char *)pData->B);
-        renderHumanPose(mPoses, frameRGB4);
-    }
-
-    return 0;
+    mExtraInferTypes = types;
 }
 
-int MediaInferenceManager::RenderRepeatLastVD(mfxFrameData *pData)
+void MediaInferenceManager::CorrectTracks()
 {
-    if (mVehicleDetector && (mVDResults.size() > 0)) {
-        Mat frameRGB4(mDecH, mDecW, CV_8UC4, (unsigned char *)pData->B);
-        mVehicleDetector->RenderVDResults(mVDResults, frameRGB4);
+    // The results of all the models, in the order of the models
+    std::vector<cv::Rect2f> boxes;
+    for (std::unique_ptr<InferModel> &model : mModels)
+    {
+        model->GetBoxes(boxes);
     }
-
-    return 0;
+    mTracker.Correct(boxes);
 }
 
-int MediaInferenceManager::RunInferHP(mfxFrameData *pData, bool inferOffline)
+void MediaInferenceManager::PredictTracks()
 {
-
-#if VERBOSE_LOG 
-	chrono::high_resolution_clock::time_point time1 = chrono::high_resolution_clock::now();
-#endif
-
-	//std::cout << "MediaInferenceManager::RunInferHP " << mDecH << " " << mDecW << std::endl;
-	unsigned char *pbuf = (pData->B < pData->R) ? pData->B : pData->R;
-	Mat frameRGB4(mDecH, mDecW, CV_8UC4, (unsigned char *)pbuf);
-	Mat frame(mDecH, mDecW, CV_8UC3);
-
-	cvtColor(frameRGB4, frame, COLOR_RGBA2BGR);
-
-#if VERBOSE_LOG 
-	chrono::high_resolution_clock::time_point time2 = chrono::high_resolution_clock::now();
-	chrono::duration<double> diff = time2 - time1;
-	cout << " pre-stage: " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-	time1 = chrono::high_resolution_clock::now();
-#endif
-
-	if (mPoses.size() > 0)
-	{
-		mPoses.clear();
-	}
-	mPoses = mHPEstimator->estimate(frame);
-
-#if VERBOSE_LOG 
-	time2 = chrono::high_resolution_clock::now();
-	diff = time2 - time1;
-	cout << " " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-	time1 = chrono::high_resolution_clock::now();
-#endif
-	if (!inferOffline) {
-		renderHumanPose(mPoses, frameRGB4);
-	}
-#if VERBOSE_LOG 
-	time2 = chrono::high_resolution_clock::now();
-	diff = time2 - time1;
-	cout << " " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-#endif
-
-	return 0;
+    std::vector<cv::Rect2f> previous(mTracker.Size());
+    for (size_t i = 0; i < previous.size(); i++)
+        previous[i] = mTracker.Box(i);
+    mTracker.Predict();
+    std::vector<cv::Rect2f> predicted(mTracker.Size());
+    for (size_t i = 0; i < predicted.size(); i++)
+        predicted[i] = mTracker.Box(i);
+
+    // The tracks are in the order of the results they were corrected with
+    size_t track = 0;
+    for (std::unique_ptr<InferModel> &model : mModels)
+    {
+        const size_t first = std::min(track, predicted.size());
+        track += model->MoveBoxes(previous.data() + first, predicted.data() + first, predicted.size() - first);
+    }
 }
 
-int MediaInferenceManager::RunInferFD(mfxFrameData *pData, bool inferOffline)
+std::vector<cv::Rect> MediaInferenceManager::InferRegions() const
 {
-#if VERBOSE_LOG
-    chrono::high_resolution_clock::time_point time1 = chrono::high_resolution_clock::now();		
-#endif
-
-	unsigned char *pbuf = (pData->B < pData->R) ? pData->B : pData->R;
-	Mat frameRGB4(mDecH, mDecW, CV_8UC4, (unsigned char *)pbuf);
-
-	Mat frame(mDecH, mDecW, CV_8UC3);
+    const cv::Rect frameRect(0, 0, mDecW, mDecH);
+    if (mRois.empty())
+    {
+        return std::vector<cv::Rect>(1, frameRect);
+    }
+    std::vector<cv::Rect> regions;
+    for (const cv::Rect &roi : mRois)
+    {
+        // Even origins, as NV12 ROIs start on a chroma sample
+        cv::Rect region(roi.x & ~1, roi.y & ~1, roi.width + (roi.x & 1), roi.height + (roi.y & 1));
+        region &= frameRect;
+        if (region.area() > 0)
+        {
+            regions.push_back(region);
+        }
+    }
+    return regions;
+}
 
-	cvtColor(frameRGB4, frame, COLOR_RGBA2BGR);
+bool MediaInferenceManager::CascadeEscalates(const InferPreprocess::Frame &frame)
+{
+    // Human pose estimation infers the whole frame, so anything in it escalates
+    const std::vector<cv::Rect> regions = HasInferType(InferTypeHumanPoseEst) ?
+        std::vector<cv::Rect>(1, cv::Rect(0, 0, mDecW, mDecH)) : InferRegions();
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        const cv::Rect &region = regions[r];
+        mCascadeDetector->Detect(frame.Roi(region.x, region.y, region.width, region.height), (int)r);
+        if (!mCascadeDetector->results.empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-#if  VERBOSE_LOG
-    chrono::high_resolution_clock::time_point time2 = chrono::high_resolution_clock::now();
-    chrono::duration<double> diff = time2 - time1;
-    cout << "pre-stage: " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-    time1 = chrono::high_resolution_clock::now();		
-#endif	
+void MediaInferenceManager::ClearResults()
+{
+    for (std::unique_ptr<InferModel> &model : mModels)
+    {
+        model->Clear();
+    }
+}
 
-   // IE_Execute(mFDCtx, mInputW, mInputH, 1.0, frame.data, &mBatchId);
-	if (mFaceDetector->results.size() > 0)
+InferPreprocess::Frame MediaInferenceManager::SurfaceFrame(mfxFrameData *pData)
+{
+	if (mFrameFormat == InferPreprocess::FormatNV12)
 	{
-		mFaceDetector->results.clear();
-	}
-
-	mFaceDetector->Detect(frame);
-
-#if  VERBOSE_LOG
-    time2 = chrono::high_resolution_clock::now();
-    diff = time2 - time1;
-    cout << "infer-stage: " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-#endif
-
-	if (!inferOffline) {
-		mFaceDetector->RenderFDResults(frameRGB4);
+		InferPreprocess::Frame frame = { pData->Y, mCropX + mDecW, mCropY + mDecH, pData->Pitch,
+			InferPreprocess::FormatNV12, pData->UV };
+		return frame.Roi(mCropX, mCropY, mDecW, mDecH);
 	}
-    return 0;
+	unsigned char *pbuf = (pData->B < pData->R) ? pData->B : pData->R;
+	InferPreprocess::Frame frame = { pbuf, mCropX + mDecW, mCropY + mDecH, pData->Pitch,
+		InferPreprocess::FormatRGB4, NULL };
+	return frame.Roi(mCropX, mCropY, mDecW, mDecH);
 }
 
-int MediaInferenceManager::RunInferVDVA(mfxFrameData *pData, bool inferOffline)
+FrameCanvas MediaInferenceManager::SurfaceCanvas(mfxFrameData *pData)
 {
-#if VERBOSE_LOG
-	chrono::high_resolution_clock::time_point time1 = chrono::high_resolution_clock::now();
-	time1 = chrono::high_resolution_clock::now();
-#endif
-
-	unsigned char *pbuf = (pData->B < pData->R) ? pData->B : pData->R;
-	Mat frameRGB4(mDecH, mDecW, CV_8UC4, (unsigned char *)pbuf);
-	Mat frameScl(mInputH, mInputH, CV_8UC4);
-	Mat frame(mInputH, mInputW, CV_8UC3);
-
-	resize(frameRGB4, frameScl, Size(mInputW, mInputH));
-	cvtColor(frameScl, frame, COLOR_RGBA2BGR);
-
-	if (mVDResults.size() > 0)
+	if (mFrameFormat == InferPreprocess::FormatNV12)
 	{
-		mVDResults.clear();
-	}
-
-#if VERBOSE_LOG
-	chrono::high_resolution_clock::time_point time2 = chrono::high_resolution_clock::now();
-	chrono::duration<double> diff = time2 - time1;
-	cout << " pre-stage: " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-	time1 = chrono::high_resolution_clock::now();
-#endif	
-
-	mVehicleDetector->Detect(frame, mVDResults, mMaxObjNum);
-
-#if VERBOSE_LOG
-	time2 = chrono::high_resolution_clock::now();
-	diff = time2 - time1;
-	cout << " " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-	time1 = chrono::high_resolution_clock::now();
-#endif
-	if (!inferOffline) {
-		mVehicleDetector->RenderVDResults(mVDResults, frameRGB4);
+		// The chroma plane has half the resolution, with 2 bytes (U and V) per sample
+		Mat y(mDecH, mDecW, CV_8UC1, pData->Y + mCropY * pData->Pitch + mCropX, pData->Pitch);
+		Mat uv(mDecH / 2, mDecW / 2, CV_8UC2, pData->UV + (mCropY / 2) * pData->Pitch + (mCropX & ~1), pData->Pitch);
+		return FrameCanvas(y, uv);
 	}
-
-#if VERBOSE_LOG
-	time2 = chrono::high_resolution_clock::now();
-	diff = time2 - time1;
-	cout << " " << fixed << "\t" << setprecision(2) << setfill('0') << diff.count()*1000.0 << "ms/frame" << endl;
-#endif
-
-	return 0;
+	unsigned char *pbuf = (pData->B < pData->R) ? pData->B : pData->R;
+	return FrameCanvas(Mat(mDecH, mDecW, CV_8UC4, pbuf + mCropY * pData->Pitch + mCropX * 4, pData->Pitch));
 }
 
 int MediaInferenceManager::InitHumanPose(msdk_char *model_dir)
@@ -350,7 +554,19 @@ int MediaInferenceManager::InitHumanPose(msdk_char *model_dir)
 		file.close();
 	}
  
-	mHPEstimator = new HumanPoseEstimator(ir_file, mTargetDevice, false);
+	HumanPoseEstimator *estimator = new HumanPoseEstimator(ir_file, mTargetDevice, false, mMaxBatch,
+		mMaxBatchWaitMs, mRequestNum, mPreprocMode, mFrameFormat);
+	mModels.emplace_back(new HumanPoseModel(estimator, mPoseFullFrameInterval));
+	// The network for the decoded size compiles while the other sessions initialize
+	if (mDecW > 0 && mDecH > 0)
+	{
+		estimator->prepare(cv::Size(mDecW, mDecH));
+		// All the square crops share one network
+		if (mPoseFullFrameInterval > 0)
+		{
+			estimator->prepare(cv::Size(mDecH, mDecH));
+		}
+	}
 
 	return 0;
 }
@@ -394,9 +610,13 @@ int MediaInferenceManager::InitFaceDetection(msdk_char *model_dir)
 		delete[]full_path;
 		file.close();
 	}
-	mFaceDetector = new FaceDetect(false);
-	mFaceDetector->SetSrcImageSize(mDecW, mDecH);
-	mFaceDetector->Init(fd_model_path, mTargetDevice);
+	FaceDetect *faceDetector = new FaceDetect(false);
+	mModels.emplace_back(new FaceDetectModel(faceDetector));
+	faceDetector->SetSrcImageSize(mDecW, mDecH);
+	faceDetector->SetTiles(mTileCols, mTileRows, mTileOverlap);
+	if (mMosaic)
+		faceDetector->SetMosaic(mMosaicTile);
+	faceDetector->Init(fd_model_path, mTargetDevice, mMaxBatch, mMaxBatchWaitMs, mRequestNum, mPreprocMode, mFrameFormat);
 
     return 0;
 }
@@ -494,9 +714,14 @@ int MediaInferenceManager::InitVehicleDetect(msdk_char *model_dir)
 
  	}
 
-	mVehicleDetector = new VehicleDetect(false);
-	mVehicleDetector->Init(ir_file_vd, ir_file_va, mTargetDevice);
-	mVehicleDetector->SetSrcImageSize(mDecW, mDecH);
+	VehicleDetect *vehicleDetector = new VehicleDetect(false);
+	mModels.emplace_back(new VehicleDetectModel(vehicleDetector, mMaxObjNum));
+	vehicleDetector->SetTiles(mTileCols, mTileRows, mTileOverlap);
+	if (mMosaic)
+		vehicleDetector->SetMosaic(mMosaicTile);
+	vehicleDetector->Init(ir_file_vd, ir_file_va, mTargetDevice, mMaxBatch, mMaxBatchWaitMs, mRequestNum,
+		mPreprocMode, mFrameFormat, mMaxObjNum);
+	vehicleDetector->SetSrcImageSize(mDecW, mDecH);
 
 	return 0;
 }
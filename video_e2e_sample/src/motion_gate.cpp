@@ -0,0 +1,113 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "motion_gate.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+/* Sum of n bytes, 16 at a time with PSADBW */
+uint32_t SumBytes(const uint8_t *data, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(data + i)), zero));
+    }
+    uint32_t total = (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+    for (; i < n; i++)
+    {
+        total += data[i];
+    }
+    return total;
+}
+
+/* Sum of the absolute differences of n bytes, n a multiple of 16 */
+uint32_t SumAbsDiff(const uint8_t *a, const uint8_t *b, int n)
+{
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < n; i += 16)
+    {
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(a + i)),
+            _mm_loadu_si128((const __m128i *)(b + i))));
+    }
+    return (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+}
+}
+
+MotionGate::MotionGate() :
+    mThreshold(0),
+    mHasReference(false),
+    mReference(GRID_WIDTH * GRID_HEIGHT),
+    mCurrent(GRID_WIDTH * GRID_HEIGHT)
+{
+}
+
+void MotionGate::Thumbnail(const InferPreprocess::Frame &frame, uint8_t *cells) const
+{
+    // RGB4 cells average all 4 bytes of the pixels. The alpha byte doesn't change, so the
+    // differences are 3/4 of the luma ones, Changed() scales them back
+    const int bytesPerPixel = (frame.format == InferPreprocess::FormatNV12) ? 1 : 4;
+    for (int gy = 0; gy < GRID_HEIGHT; gy++)
+    {
+        const int y0 = gy * frame.height / GRID_HEIGHT;
+        const int y1 = (gy + 1) * frame.height / GRID_HEIGHT;
+        for (int gx = 0; gx < GRID_WIDTH; gx++)
+        {
+            const int x0 = gx * frame.width / GRID_WIDTH;
+            const int x1 = (gx + 1) * frame.width / GRID_WIDTH;
+            uint32_t sum = 0;
+            uint32_t count = 0;
+            for (int y = y0; y < y1; y += ROW_STEP)
+            {
+                sum += SumBytes(frame.data + (size_t)y * frame.pitch + (size_t)x0 * bytesPerPixel,
+                    (x1 - x0) * bytesPerPixel);
+                count += (x1 - x0) * bytesPerPixel;
+            }
+            cells[gy * GRID_WIDTH + gx] = (uint8_t)(count ? (sum + count / 2) / count : 0);
+        }
+    }
+}
+
+bool MotionGate::Changed(const InferPreprocess::Frame &frame)
+{
+    if (!IsEnabled() || frame.width <= 0 || frame.height <= 0)
+    {
+        return true;
+    }
+
+    Thumbnail(frame, mCurrent.data());
+    bool changed = true;
+    if (mHasReference)
+    {
+        float difference = (float)SumAbsDiff(mCurrent.data(), mReference.data(), GRID_WIDTH * GRID_HEIGHT) /
+            (GRID_WIDTH * GRID_HEIGHT);
+        if (frame.format != InferPreprocess::FormatNV12)
+        {
+            difference = difference * 4 / 3;
+        }
+        changed = (difference >= mThreshold);
+    }
+    if (changed)
+    {
+        mReference.swap(mCurrent);
+        mHasReference = true;
+    }
+    return changed;
+}
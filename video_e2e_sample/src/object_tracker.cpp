@@ -0,0 +1,124 @@
+/******************************************************************************\
+Copyright (c) 2005-2020, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+\**********************************************************************************/
+
+#include "object_tracker.h"
+
+#include <algorithm>
+
+ObjectTracker::ObjectTracker() :
+    mFramesSinceCorrect(0),
+    mMinIoU(0.3f),
+    mGain(0.5f),
+    mMaxGrowth(0.05f)
+{
+}
+
+float ObjectTracker::IoU(const cv::Rect2f &a, const cv::Rect2f &b)
+{
+    float intersection = (a & b).area();
+    float area = a.area() + b.area() - intersection;
+    return area > 0 ? intersection / area : 0;
+}
+
+cv::Rect2f ObjectTracker::Box(size_t i) const
+{
+    const Track &track = mTracks[i];
+    return cv::Rect2f(track.center.x - track.size.width / 2, track.center.y - track.size.height / 2,
+        track.size.width, track.size.height);
+}
+
+void ObjectTracker::Clear()
+{
+    mTracks.clear();
+    mFramesSinceCorrect = 0;
+}
+
+void ObjectTracker::Predict()
+{
+    for (Track &track : mTracks)
+    {
+        track.center += track.velocity;
+        track.size.width = std::max(track.size.width + track.growth.width, 1.0f);
+        track.size.height = std::max(track.size.height + track.growth.height, 1.0f);
+    }
+    mFramesSinceCorrect++;
+}
+
+void ObjectTracker::Correct(const std::vector<cv::Rect2f> &boxes)
+{
+    // Greedy association, the pairs with the highest IoU first. The tracks have been moved to
+    // the current frame by Predict(), so moving objects still overlap their boxes
+    struct Pair
+    {
+        float iou;
+        size_t track;
+        size_t box;
+    };
+    std::vector<Pair> pairs;
+    for (size_t t = 0; t < mTracks.size(); t++)
+    {
+        cv::Rect2f predicted = Box(t);
+        for (size_t b = 0; b < boxes.size(); b++)
+        {
+            float iou = IoU(predicted, boxes[b]);
+            if (iou >= mMinIoU)
+            {
+                pairs.push_back({ iou, t, b });
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) { return a.iou > b.iou; });
+
+    std::vector<int> boxTrack(boxes.size(), -1);
+    std::vector<bool> trackUsed(mTracks.size(), false);
+    for (const Pair &pair : pairs)
+    {
+        if (boxTrack[pair.box] < 0 && !trackUsed[pair.track])
+        {
+            boxTrack[pair.box] = static_cast<int>(pair.track);
+            trackUsed[pair.track] = true;
+        }
+    }
+
+    // The tracks follow the order of the boxes, the tracks without a box are dropped
+    const float frames = static_cast<float>(std::max(mFramesSinceCorrect, 1));
+    std::vector<Track> tracks(boxes.size());
+    for (size_t b = 0; b < boxes.size(); b++)
+    {
+        Track &track = tracks[b];
+        track.center = cv::Point2f(boxes[b].x + boxes[b].width / 2, boxes[b].y + boxes[b].height / 2);
+        track.size = boxes[b].size();
+        track.velocity = cv::Point2f(0, 0);
+        track.growth = cv::Size2f(0, 0);
+        if (boxTrack[b] < 0)
+        {
+            continue;
+        }
+
+        // The prediction error spread over the frames since the last correction
+        const Track &previous = mTracks[boxTrack[b]];
+        cv::Point2f error = (track.center - previous.center) * (1.0f / frames);
+        track.velocity = previous.velocity + error * mGain;
+        float maxWidth = track.size.width * mMaxGrowth;
+        float maxHeight = track.size.height * mMaxGrowth;
+        track.growth.width = std::min(std::max(previous.growth.width +
+            (track.size.width - previous.size.width) / frames * mGain, -maxWidth), maxWidth);
+        track.growth.height = std::min(std::max(previous.growth.height +
+            (track.size.height - previous.size.height) / frames * mGain, -maxHeight), maxHeight);
+    }
+    mTracks.swap(tracks);
+    mFramesSinceCorrect = 0;
+}
@@ -124,9 +124,28 @@ sInputParams::sInputParams() : __sInputParams()
 #endif
 	InferType = MediaInferenceManager::InferTypeNone;
 	InferOffline = false;
+	InferTracking = false;
+	InferIntervalMin = 0;
+	InferIntervalMax = 0;
+	InferRate = 0;
+	InferActivityThreshold = 0;
+	InferTileCols = 1;
+	InferTileRows = 1;
+	InferTileOverlap = 0.15;
+	InferMosaic = false;
+	InferMosaicW = 0;
+	InferMosaicH = 0;
+	InferMotionThreshold = 0;
+	InferCascadeThreshold = 0.5;
+	InferHPFullFrameInterval = 0;
 	bDropDecOutput = false;
 	InferDevType = MediaInferenceManager::InferDeviceGPU;
 	InferMaxObjNum = -1; //-1 means no limitation
+	InferPreprocMode = InferPreprocess::ModeCPU;
+	InferAsyncDepth = 0;
+	InferBatch = 1;
+	InferBatchTimeout = 10;
+	InferRequests = 1;
 }
 
 CTranscodingPipeline::CTranscodingPipeline():
@@ -209,6 +228,9 @@ CTranscodingPipeline::CTranscodingPipeline():
 	mInferInterval = 6;
 	mInferOffline = false;
 	mInferDevType = MediaInferenceManager::InferDeviceGPU;
+	mInferAsyncDepth = 0;
+	m_pInferThread = nullptr;
+	m_InferStageSts = MFX_ERR_NONE;
 	m_decOutW = 300;
 	m_decOutH = 300;
 } //CTranscodingPipeline::CTranscodingPipeline()
@@ -910,6 +932,11 @@ mfxStatus CTranscodingPipeline::Decode()
         return MFX_ERR_NONE;
     }
 
+#if OVINO
+    sts = StartInferStage();
+    MSDK_CHECK_STATUS(sts, "StartInferStage failed");
+#endif
+
     while (MFX_ERR_NONE == sts)
     {
         pNextBuffer = m_pBuffer;
@@ -958,6 +985,9 @@ mfxStatus CTranscodingPipeline::Decode()
                 {
                     inputStatistics.PrintStatistics(GetPipelineID());
                     inputStatistics.ResetStatistics();
+#if OVINO
+                    PrintInferStatistics();
+#endif
                 }
             }
             if (sts == MFX_ERR_MORE_DATA && (m_pmfxVPP.get() || m_pmfxPreENC.get()))
@@ -1103,71 +1133,28 @@ mfxStatus CTranscodingPipeline::Decode()
 		sts = m_pmfxSession->SyncOperation(VppExtSurface.Syncp, MSDK_WAIT_INTERVAL);
 		MSDK_CHECK_STATUS(sts, "m_pmfxSession->SyncOperation failed");
 		VppExtSurface.Syncp = NULL;
-		mfxFrameSurface1 * vppOut = VppExtSurface.pSurface;
-		sts = m_pMFXAllocator->Lock(m_pMFXAllocator->pthis, vppOut->Data.MemId, &(vppOut->Data));
-		MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Lock failed");
-		mfxFrameData * pData = &(vppOut->Data);
-		
-		#if !LESS_P
-		 mfxFrameInfo * pInfo = &(vppOut->Info);
-		       //crop height 1080, real height 1088, width 1920
-		std::cout << "info: w " << pInfo->CropW << " h: " << pInfo->CropH << \
-		 " pitch " << pData->Pitch << " FourCC " << pInfo->FourCC << std::endl;
-		std::cout << MFX_FOURCC_I420 << " " << MFX_FOURCC_NV12 << " " << MFX_FOURCC_RGB4 << " " << MFX_FOURCC_YUY2 << std::endl;
-		
-		std::cout << "info: real w " << pInfo->Width << " real h: " << pInfo->Height << std::endl;
-		       //cout << "Y: " << hex << pData->Y << " UV: " << hex << pData->UV << endl;
-		printf("info Y: %x, UV: %x\n", pData->Y, pData->UV);
-		printf("info R: %x, G: %x, B: %x, A: %x\n", pData->R, pData->G, pData->B, pData->A);
-		#endif
-
-	   if ((!m_bEncodeEnable)
-		   && (mInferType != MediaInferenceManager::InferTypeNone))
-	   {
-		   /* Run inference every infer_interval frame */
-		   bool runInfer = !(m_nProcessedFramesNum % mInferInterval);
-		   if (runInfer)
-		   {
-			   mInferMnger.RunInfer(pData, mInferOffline);
-		   }
-		   else if (!mInferOffline)
-		   {
-			   mInferMnger.RenderRepeatLast(pData);
-		   }
-	   }
-
-		 m_pMFXAllocator->Unlock(m_pMFXAllocator->pthis, vppOut->Data.MemId, &(vppOut->Data));
-		PreEncExtSurface.pSurface = vppOut;
-        // add surfaces in queue for all sinks
-        pNextBuffer->AddSurface(PreEncExtSurface);
-        /* one of key parts for N_to_1 mode:
-        * decoded frame should be in one buffer only as we have only 1 (one!) sink
-        * */
-        if (0 == m_nVPPCompEnable)
-        {
-            while (pNextBuffer->m_pNext)
-            {
-                pNextBuffer = pNextBuffer->m_pNext;
-                pNextBuffer->AddSurface(PreEncExtSurface);
-            }
-        }
+		PreEncExtSurface.pSurface = VppExtSurface.pSurface;
 
-        // We need to synchronize oldest stored surface if we've already stored enough surfaces in buffer (buffer length >= AsyncDepth)
-        // Because we have to wait for decoder to finish processing and free some internally used surfaces
-        //mfxU32 len = pNextBuffer->GetLength();
-        if(pNextBuffer->GetLength()>=m_AsyncDepth)
-        {
-            ExtendedSurface frontSurface;
-            pNextBuffer->GetSurface(frontSurface);
-
-            if(frontSurface.Syncp)
-            {
-                sts = m_pmfxSession->SyncOperation(frontSurface.Syncp, MSDK_WAIT_INTERVAL);
-                HandlePossibleGpuHang(sts);
-                MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "SyncOperation failed");
-                frontSurface.Syncp=NULL;
-            }
-        }
+#if OVINO
+		/* Run inference every infer_interval frame, or at the interval adapted to the inference rate */
+		bool runInfer = mInferCadence.NextFrame(m_pBSProcessor ? m_pBSProcessor->GetFrameActivity() : -1);
+		if (m_pInferThread)
+		{
+			// inference thread renders the results and adds the surface to the buffers
+			sts = PushToInferStage(PreEncExtSurface, runInfer);
+			MSDK_BREAK_ON_ERROR(sts);
+		}
+		else
+		{
+			sts = InferFrame(PreEncExtSurface.pSurface, runInfer);
+			MSDK_BREAK_ON_ERROR(sts);
+			sts = DeliverDecodedSurface(PreEncExtSurface);
+			MSDK_BREAK_ON_ERROR(sts);
+		}
+#else
+		sts = DeliverDecodedSurface(PreEncExtSurface);
+		MSDK_BREAK_ON_ERROR(sts);
+#endif
 
         if (!statisticsWindowSize && 0 == (m_nProcessedFramesNum - 1) % 100)
         {
@@ -1192,6 +1179,13 @@ mfxStatus CTranscodingPipeline::Decode()
 
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
 
+#if OVINO
+    // surfaces still queued for inference must reach the sinks before the end of stream
+    StopInferStage();
+    if (MFX_ERR_NONE == sts)
+        sts = m_InferStageSts;
+#endif
+
     NoMoreFramesSignal();
 
     if (MFX_ERR_NONE == sts)
@@ -1200,6 +1194,212 @@ mfxStatus CTranscodingPipeline::Decode()
     return sts;
 } // mfxStatus CTranscodingPipeline::Decode()
 
+mfxStatus CTranscodingPipeline::DeliverDecodedSurface(ExtendedSurface &extSurface)
+{
+    mfxStatus sts = MFX_ERR_NONE;
+    SafetySurfaceBuffer *pNextBuffer = m_pBuffer;
+
+    // add surfaces in queue for all sinks
+    pNextBuffer->AddSurface(extSurface);
+    /* one of key parts for N_to_1 mode:
+    * decoded frame should be in one buffer only as we have only 1 (one!) sink
+    * */
+    if (0 == m_nVPPCompEnable)
+    {
+        while (pNextBuffer->m_pNext)
+        {
+            pNextBuffer = pNextBuffer->m_pNext;
+            pNextBuffer->AddSurface(extSurface);
+        }
+    }
+
+    // We need to synchronize oldest stored surface if we've already stored enough surfaces in buffer (buffer length >= AsyncDepth)
+    // Because we have to wait for decoder to finish processing and free some internally used surfaces
+    //mfxU32 len = pNextBuffer->GetLength();
+    if(pNextBuffer->GetLength()>=m_AsyncDepth)
+    {
+        ExtendedSurface frontSurface;
+        pNextBuffer->GetSurface(frontSurface);
+
+        if(frontSurface.Syncp)
+        {
+            sts = m_pmfxSession->SyncOperation(frontSurface.Syncp, MSDK_WAIT_INTERVAL);
+            HandlePossibleGpuHang(sts);
+            MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "SyncOperation failed");
+            frontSurface.Syncp=NULL;
+        }
+    }
+
+    return sts;
+} // mfxStatus CTranscodingPipeline::DeliverDecodedSurface(ExtendedSurface &extSurface)
+
+#if OVINO
+mfxStatus CTranscodingPipeline::InferFrame(mfxFrameSurface1 *pSurface, bool runInfer)
+{
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+
+    mfxStatus sts = m_pMFXAllocator->Lock(m_pMFXAllocator->pthis, pSurface->Data.MemId, &(pSurface->Data));
+    MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Lock failed");
+    mfxFrameData * pData = &(pSurface->Data);
+
+#if !LESS_P
+    mfxFrameInfo * pInfo = &(pSurface->Info);
+    //crop height 1080, real height 1088, width 1920
+    std::cout << "info: w " << pInfo->CropW << " h: " << pInfo->CropH << \
+        " pitch " << pData->Pitch << " FourCC " << pInfo->FourCC << std::endl;
+    std::cout << MFX_FOURCC_I420 << " " << MFX_FOURCC_NV12 << " " << MFX_FOURCC_RGB4 << " " << MFX_FOURCC_YUY2 << std::endl;
+
+    std::cout << "info: real w " << pInfo->Width << " real h: " << pInfo->Height << std::endl;
+    printf("info Y: %x, UV: %x\n", pData->Y, pData->UV);
+    printf("info R: %x, G: %x, B: %x, A: %x\n", pData->R, pData->G, pData->B, pData->A);
+#endif
+
+    if ((!m_bEncodeEnable)
+        && (mInferType != MediaInferenceManager::InferTypeNone))
+    {
+        if (runInfer)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            // frames skipped by the motion gate say nothing about the inference time
+            if (mInferMnger.RunInfer(pSurface, mInferOffline) == 0)
+            {
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                // With several requests in flight RunInfer() returns once the frame is submitted, the
+                // requests measure how long the results take
+                mInferCadence.InferenceDone(std::max(elapsed.count(), mInferMnger.InferLatencyMs()));
+            }
+        }
+        else if (!mInferOffline)
+        {
+            mInferMnger.RenderRepeatLast(pSurface);
+        }
+    }
+
+    m_pMFXAllocator->Unlock(m_pMFXAllocator->pthis, pSurface->Data.MemId, &(pSurface->Data));
+    return MFX_ERR_NONE;
+} // mfxStatus CTranscodingPipeline::InferFrame(mfxFrameSurface1 *pSurface, bool runInfer)
+
+mfxStatus CTranscodingPipeline::StartInferStage()
+{
+    if (m_pInferThread || mInferAsyncDepth <= 0
+        || m_bEncodeEnable || (mInferType == MediaInferenceManager::InferTypeNone))
+    {
+        return MFX_ERR_NONE;
+    }
+
+    m_InferQueue.clear();
+    m_InferStageSts = MFX_ERR_NONE;
+    m_pInferThread = new std::thread(InferStageRoutine, this);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CTranscodingPipeline::PushToInferStage(ExtendedSurface &extSurface, bool runInfer)
+{
+    InferStageTask task;
+    task.ExtSurface = extSurface;
+    task.bRunInfer = runInfer;
+
+    // the surface must not be reused by decoder or VPP until the inference thread delivered it
+    if (extSurface.pSurface)
+    {
+        msdk_atomic_inc16((volatile mfxU16 *)(&extSurface.pSurface->Data.Locked));
+    }
+
+    mfxStatus sts = MFX_ERR_NONE;
+    {
+        std::unique_lock<std::mutex> lock(m_mInferQueue);
+        // a full queue means the inference doesn't keep up with decoding
+        if (extSurface.pSurface)
+        {
+            mInferCadence.SetBacklog(m_InferQueue.size(), (size_t)mInferAsyncDepth);
+        }
+        // the end of stream task (NULL surface) is always accepted
+        m_cvInferQueue.wait(lock, [this, &extSurface] {
+            return !extSurface.pSurface || m_InferQueue.size() < (size_t)mInferAsyncDepth;
+        });
+        m_InferQueue.push_back(task);
+        sts = m_InferStageSts;
+    }
+    m_cvInferQueue.notify_all();
+
+    return sts;
+}
+
+void CTranscodingPipeline::PrintInferStatistics()
+{
+    if (mInferType == MediaInferenceManager::InferTypeNone)
+    {
+        return;
+    }
+    // the cadence counts the frames sent to inference, the motion gate may have skipped some of them
+    const mfxU32 skipped = mInferMnger.MotionSkippedFrames();
+    const mfxU32 scheduled = mInferCadence.InferredFrames();
+    msdk_printf(MSDK_STRING("Pipeline %d inference: interval %d%s, %u of %u frames inferred, %u skipped as unchanged, %u for low bitstream activity\n"),
+        GetPipelineID(), mInferCadence.Interval(), mInferCadence.IsAdaptive() ? MSDK_STRING(" (adaptive)") : MSDK_STRING(""),
+        scheduled > skipped ? scheduled - skipped : 0, mInferCadence.Frames(), skipped, mInferCadence.InactiveFrames());
+    if (mInferMnger.IsCascade())
+    {
+        const MediaInferenceManager::CascadeStatistics cascade = mInferMnger.GetCascadeStatistics();
+        msdk_printf(MSDK_STRING("Pipeline %d cascade: %u of %u frames escalated, cheap tier %.2f ms/frame, full tier %.2f ms/frame\n"),
+            GetPipelineID(), cascade.escalated, cascade.frames, cascade.cheapMs, cascade.fullMs);
+    }
+}
+
+void CTranscodingPipeline::StopInferStage()
+{
+    if (!m_pInferThread)
+    {
+        return;
+    }
+
+    ExtendedSurface eos = {0};
+    PushToInferStage(eos, false);
+
+    m_pInferThread->join();
+    delete m_pInferThread;
+    m_pInferThread = nullptr;
+}
+
+void CTranscodingPipeline::InferStageRoutine(CTranscodingPipeline *pipeline)
+{
+    for (;;)
+    {
+        InferStageTask task;
+        {
+            std::unique_lock<std::mutex> lock(pipeline->m_mInferQueue);
+            pipeline->m_cvInferQueue.wait(lock, [pipeline] { return !pipeline->m_InferQueue.empty(); });
+            task = pipeline->m_InferQueue.front();
+            pipeline->m_InferQueue.pop_front();
+        }
+        // wake up the decoding thread waiting for a free slot
+        pipeline->m_cvInferQueue.notify_all();
+
+        mfxFrameSurface1 *pSurface = task.ExtSurface.pSurface;
+        if (!pSurface)
+        {
+            break;
+        }
+
+        // keep delivering surfaces after an error, the decoding thread stops on the next push
+        mfxStatus sts = pipeline->InferFrame(pSurface, task.bRunInfer);
+        if (MFX_ERR_NONE == sts)
+        {
+            sts = pipeline->DeliverDecodedSurface(task.ExtSurface);
+        }
+        msdk_atomic_dec16((volatile mfxU16 *)(&pSurface->Data.Locked));
+
+        if (MFX_ERR_NONE != sts)
+        {
+            std::lock_guard<std::mutex> lock(pipeline->m_mInferQueue);
+            if (MFX_ERR_NONE == pipeline->m_InferStageSts)
+            {
+                pipeline->m_InferStageSts = sts;
+            }
+        }
+    }
+}
+#endif
+
 mfxStatus CTranscodingPipeline::DeliverLoop(CTranscodingPipeline* pipeline)
 {
     mfxStatus res = MFX_ERR_NONE;
@@ -3534,6 +3734,14 @@ mfxStatus CTranscodingPipeline::AllocFrames()
         {
             VPPOut.Type |= MFX_MEMTYPE_EXPORT_FRAME;
         }
+#endif
+#if OVINO
+        // surfaces waiting in the inference queue plus the one being inferred
+        if (mInferAsyncDepth > 0)
+        {
+            VPPOut.NumFrameSuggested += (mfxU16)(mInferAsyncDepth + 1);
+            VPPOut.NumFrameMin += (mfxU16)(mInferAsyncDepth + 1);
+        }
 #endif
         sts = AllocFrames(&VPPOut, false);
         MSDK_CHECK_STATUS(sts, "AllocFrames failed");
@@ -3558,6 +3766,14 @@ mfxStatus CTranscodingPipeline::AllocFrames()
             }
 
             // AllocId just opaque handle which allow separate decoder requests in case of VPP Composition with external allocator
+#if OVINO
+            // no VPP, decoded surfaces go to the inference queue
+            if (mInferAsyncDepth > 0 && !VPPOut.NumFrameSuggested)
+            {
+                DecOut.NumFrameSuggested += (mfxU16)(mInferAsyncDepth + 1);
+                DecOut.NumFrameMin += (mfxU16)(mInferAsyncDepth + 1);
+            }
+#endif
             static mfxU32 mark_alloc = 0;
             m_mfxDecParams.AllocId = mark_alloc;
             DecOut.AllocId = mark_alloc;
@@ -3831,6 +4047,10 @@ mfxStatus CTranscodingPipeline::Init(sInputParams *pParams,
     m_nTimeout = pParams->nTimeout;
 
     m_AsyncDepth = (0 == pParams->nAsyncDepth)? 1: pParams->nAsyncDepth;
+#if OVINO
+    // needed before AllocFrames to reserve the surfaces queued for inference
+    mInferAsyncDepth = (MediaInferenceManager::InferTypeNone != pParams->InferType) ? pParams->InferAsyncDepth : 0;
+#endif
     m_FrameNumberPreference = pParams->FrameNumberPreference;
     m_numEncoders = 0;
     m_bUseOverlay = pParams->DecodeId == MFX_CODEC_RGB4 ? true : false;
@@ -4105,10 +4325,48 @@ mfxStatus CTranscodingPipeline::Init(sInputParams *pParams,
 			break;
 		}
 	}
+	{
+		const mfxFrameInfo &decInfo = m_mfxDecParams.mfx.FrameInfo;
+		double inputFps = decInfo.FrameRateExtD ? (double)decInfo.FrameRateExtN / decInfo.FrameRateExtD : 0;
+		mInferCadence.Init(mInferInterval, pParams->InferIntervalMin, pParams->InferIntervalMax, pParams->InferRate,
+			inputFps);
+		mInferCadence.SetActivityThreshold(pParams->InferActivityThreshold);
+	}
 	msdk_opt_read(pParams->strIRFileDir, mStrIRFileDir);
 	if (mInferType != MediaInferenceManager::InferTypeNone)
 	{
-		if (0 != mInferMnger.Init(m_mfxVppParams.vpp.Out.CropW, m_mfxVppParams.vpp.Out.CropH,
+		mInferMnger.SetBatchMode(pParams->InferBatch, pParams->InferBatchTimeout);
+		mInferMnger.SetRequestNum(pParams->InferRequests);
+		mInferMnger.SetPreprocessMode(pParams->InferPreprocMode);
+		mInferMnger.SetTracking(pParams->InferTracking);
+		mInferMnger.SetMotionThreshold((float)pParams->InferMotionThreshold);
+		mInferMnger.SetCascade(pParams->strInferCascadeModel, (float)pParams->InferCascadeThreshold);
+		mInferMnger.SetHumanPoseCrops(pParams->InferHPFullFrameInterval);
+		mInferMnger.SetExtraInferTypes(pParams->InferExtraTypes);
+		mInferMnger.SetRois(pParams->InferRois);
+		mInferMnger.SetTiles(pParams->InferTileCols, pParams->InferTileRows, (float)pParams->InferTileOverlap);
+		if (pParams->InferMosaic)
+		{
+			// The tile of the session in the mosaic is where the composition places it
+			mInferMnger.SetMosaic(cv::Rect(pParams->nVppCompDstX, pParams->nVppCompDstY, pParams->nVppCompDstW, pParams->nVppCompDstH),
+				cv::Size(pParams->InferMosaicW, pParams->InferMosaicH));
+		}
+		// The inference reads the surfaces the pipeline outputs, the VPP ones if there is VPP
+		const mfxFrameInfo &inferFrameInfo = m_bIsVpp ? m_mfxVppParams.vpp.Out : m_mfxDecParams.mfx.FrameInfo;
+		switch (inferFrameInfo.FourCC)
+		{
+		case MFX_FOURCC_RGB4:
+			mInferMnger.SetFrameFormat(InferPreprocess::FormatRGB4);
+			break;
+		case MFX_FOURCC_NV12:
+			mInferMnger.SetFrameFormat(InferPreprocess::FormatNV12);
+			break;
+		default:
+			msdk_printf(MSDK_STRING("ERROR: inference needs NV12 or RGB4 frames\n"));
+			NoMoreFramesSignal();
+			return MFX_ERR_UNSUPPORTED;
+		}
+		if (0 != mInferMnger.Init(inferFrameInfo.CropW, inferFrameInfo.CropH,
 			mInferType, (msdk_char *)mStrIRFileDir, mInferDevType, mInferMaxObjNum))
 		{
 			NoMoreFramesSignal();
@@ -4464,6 +4722,10 @@ size_t CTranscodingPipeline::GetRobustFlag()
 
 void CTranscodingPipeline::Close()
 {
+#if OVINO
+    StopInferStage();
+#endif
+
     if (m_pmfxDEC.get())
         m_pmfxDEC->Close();
 
@@ -5010,6 +5272,15 @@ mfxStatus FileBitstreamProcessor::GetInputBitstream(mfxBitstreamWrapper **pBitst
 
 }
 
+mfxF64 FileBitstreamProcessor::GetFrameActivity()
+{
+    if (!m_pFileReader.get())
+    {
+        return -1;
+    }
+    return m_pFileReader->PopFrameActivity();
+}
+
 mfxStatus FileBitstreamProcessor::GetInputFrame(mfxFrameSurface1 * pSurface)
 {
     //MSDK_CHECK_POINTER(pSurface);
@@ -33,6 +33,7 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 #endif
 
 #include <future>
+#include <set>
 using namespace std;
 using namespace TranscodingSample;
 #define RTSP_SUPPORT
@@ -304,6 +305,101 @@ mfxStatus Launcher::Init(int argc, msdk_char *argv[])
         m_VppDstRects.push_back(tempDstRect);
     }
 
+#if OVINO
+    // The mosaic covers the tiles of all its sessions
+    mfxU16 inferMosaicW = 0, inferMosaicH = 0;
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+    {
+        const sInputParams &params = m_InputParamsArray[i];
+        if (!params.InferMosaic)
+            continue;
+        if (!params.nVppCompDstW || !params.nVppCompDstH)
+        {
+            msdk_printf(MSDK_STRING("WARNING: session %d has no -vpp_comp_dst_w/h tile, it's not inferred on the mosaic\n"), (int)i);
+            continue;
+        }
+        if (params.nVppCompDstX + params.nVppCompDstW > inferMosaicW)
+            inferMosaicW = (mfxU16)(params.nVppCompDstX + params.nVppCompDstW);
+        if (params.nVppCompDstY + params.nVppCompDstH > inferMosaicH)
+            inferMosaicH = (mfxU16)(params.nVppCompDstY + params.nVppCompDstH);
+    }
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+    {
+        m_InputParamsArray[i].InferMosaicW = inferMosaicW;
+        m_InputParamsArray[i].InferMosaicH = inferMosaicH;
+    }
+
+    // Start loading the inference networks of all the sessions in parallel, the sessions below
+    // pick up the networks being loaded instead of loading them one after another
+    std::vector<std::unique_ptr<MediaInferenceManager>> inferPreloads;
+    std::vector<std::future<void>> inferPreloadDone;
+    std::set<msdk_string> inferPreloadKeys;
+    // VerifyCrossSessionsOptions made sure the sessions agree on the cache directory
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+    {
+        if (m_InputParamsArray[i].strInferCacheDir[0])
+        {
+            MediaInferenceManager::SetNetworkCacheDir(m_InputParamsArray[i].strInferCacheDir);
+            break;
+        }
+    }
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+    {
+        sInputParams &params = m_InputParamsArray[i];
+        if (params.InferType == MediaInferenceManager::InferTypeNone)
+            continue;
+
+        // The frame format is only part of the network when the plugin does the preprocessing. The
+        // session infers on the VPP output if there is VPP, see VPPPreInit and InitVppMfxParams: RGB4
+        // with -dc::rgb4, the encoder FourCC when it needs a conversion, otherwise the decoder NV12.
+        // A wrong guess only costs a network the session loads again
+        const bool pluginPreproc = params.InferPreprocMode == InferPreprocess::ModeIE;
+        const bool decodeEnable = params.eMode != Source;
+        const bool encodeEnable = params.eMode != Sink && params.eModeExt != FakeSink;
+        mfxU32 inferFourCC = MFX_FOURCC_NV12;
+        if (decodeEnable && params.DecoderFourCC == MFX_FOURCC_RGB4)
+            inferFourCC = MFX_FOURCC_RGB4;
+        else if (encodeEnable && params.EncoderFourCC)
+            inferFourCC = params.EncoderFourCC;
+
+        msdk_stringstream key;
+        key << params.InferType;
+        for (int type : params.InferExtraTypes)
+            key << MSDK_STRING("+") << type;
+        key << MSDK_STRING("|") << params.strIRFileDir << MSDK_STRING("|") << params.InferDevType
+            << MSDK_STRING("|") << params.InferBatch << MSDK_STRING("|") << params.InferRequests
+            << MSDK_STRING("|") << params.InferPreprocMode << MSDK_STRING("|") << (pluginPreproc ? inferFourCC : 0)
+            << MSDK_STRING("|") << params.InferMaxObjNum << MSDK_STRING("|") << params.InferTileCols
+            << MSDK_STRING("x") << params.InferTileRows << MSDK_STRING("|") << params.InferMosaic
+            << MSDK_STRING("|") << params.strInferCascadeModel;
+        if (!inferPreloadKeys.insert(key.str()).second)
+            continue;
+
+        std::unique_ptr<MediaInferenceManager> preload(new MediaInferenceManager);
+        preload->SetBatchMode(params.InferBatch, params.InferBatchTimeout);
+        preload->SetRequestNum(params.InferRequests);
+        preload->SetPreprocessMode(params.InferPreprocMode);
+        preload->SetTiles(params.InferTileCols, params.InferTileRows, (float)params.InferTileOverlap);
+        if (params.InferMosaic)
+            preload->SetMosaic(cv::Rect(0, 0, 1, 1), cv::Size(1, 1));
+        preload->SetCascade(params.strInferCascadeModel, (float)params.InferCascadeThreshold);
+        preload->SetExtraInferTypes(params.InferExtraTypes);
+        preload->SetFrameFormat(inferFourCC == MFX_FOURCC_RGB4 ? InferPreprocess::FormatRGB4 : InferPreprocess::FormatNV12);
+        MediaInferenceManager *pPreload = preload.get();
+        inferPreloadDone.push_back(std::async(std::launch::async, [pPreload, &params]() {
+            try
+            {
+                // Failures are reported again by the session that loads the same network
+                pPreload->Init(0, 0, params.InferType, params.strIRFileDir, params.InferDevType, params.InferMaxObjNum);
+            }
+            catch (...)
+            {
+            }
+        }));
+        inferPreloads.push_back(std::move(preload));
+    }
+#endif
+
     // create sessions, allocators
     for (i = 0; i < m_InputParamsArray.size(); i++)
     {
@@ -471,6 +567,13 @@ mfxStatus Launcher::Init(int argc, msdk_char *argv[])
         PrintInfo(i, &m_InputParamsArray[i], &ver);
     }
 
+#if OVINO
+    // The sessions hold their own references to the loaded networks
+    for (auto &done : inferPreloadDone)
+        done.wait();
+    inferPreloads.clear();
+#endif
+
     for (i = 0; i < m_InputParamsArray.size(); i++)
     {
         sts = m_pThreadContextArray[i]->pPipeline->CompleteInit();
@@ -960,6 +1063,22 @@ mfxStatus Launcher::VerifyCrossSessionsOptions()
             }
         }
 
+#if OVINO
+        // The compiled networks are shared by all sessions, so is the directory that caches them
+        if (m_InputParamsArray[i].strInferCacheDir[0])
+        {
+            for (mfxU32 j = 0; j < m_InputParamsArray.size(); j++)
+            {
+                if (m_InputParamsArray[j].strInferCacheDir[0] &&
+                    msdk_string(m_InputParamsArray[j].strInferCacheDir) != msdk_string(m_InputParamsArray[i].strInferCacheDir))
+                {
+                    PrintError(MSDK_STRING("Error in par file. All the sessions with -infer::cache_dir should use the same directory\n"));
+                    return MFX_ERR_UNSUPPORTED;
+                }
+            }
+        }
+#endif
+
         if (Source == m_InputParamsArray[i].eMode)
         {
             if (m_InputParamsArray[i].nAsyncDepth < minAsyncDepth)
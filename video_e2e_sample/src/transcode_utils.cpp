@@ -359,11 +359,29 @@ void TranscodingSample::PrintHelp()
     msdk_printf(MSDK_STRING("  -preset <default,dss,conference,gaming> Use particular preset for encoding parameters\n"));
     msdk_printf(MSDK_STRING("  -pp                         Print preset parameters\n"));
 	msdk_printf(MSDK_STRING("Inference parameters :\n"));
-	msdk_printf(MSDK_STRING("  -infer::<fd,hp,vd> <IR_files_directory>  specify the inference mode and directory that stores IR files(.xml, .bin). The inference function uses the output surface of decode as input and renders the results on it\n"));
+	msdk_printf(MSDK_STRING("  -infer::<fd,hp,vd> <IR_files_directory>  specify the inference mode and directory that stores IR files(.xml, .bin). The inference function uses the output surface of decode as input and renders the results on it. Repeat it with another mode to run several models on the same frames concurrently, the directory of the last one is used for all of them\n"));
 	msdk_printf(MSDK_STRING("  -infer::offline              With this option, the inference results won't be rendered to surface\n)"));
 	msdk_printf(MSDK_STRING("  -infer::device <GPU, HDDL, CPU>   Specify the target inference device. GPU is used by default\n)"));
 	msdk_printf(MSDK_STRING("  -infer::interval <number>    Specify inference interval. For example, '-infer::interval 6' means every 6 frame, there is one frame will be inferenced, and the inference fps is 30/6 = 5. By default, interval is 6 for face detection, 6 for human pose estimation and 1 for vehicel detection.\n)"));
+	msdk_printf(MSDK_STRING("  -infer::rate <fps>           Adapt the inference interval at runtime to infer <fps> frames per second, from the input frame rate and the measured inference time. The interval is raised while the inference can't keep up. The chosen interval is printed with the statistics (-stat)\n"));
+	msdk_printf(MSDK_STRING("  -infer::interval_min <number> -infer::interval_max <number>  Bounds of the interval adapted with -infer::rate. 1 and 30 by default\n"));
+	msdk_printf(MSDK_STRING("  -infer::motion_threshold <levels>  Don't infer the frames whose downscaled luma differs from the last inferred frame by less than <levels> (0-255) on average, the last results are rendered instead. 2 is a good start for fixed cameras. The skipped frames are counted in the statistics (-stat). 0 (default) infers all the frames\n"));
+	msdk_printf(MSDK_STRING("  -infer::activity_threshold <ratio>  RTSP input only. Don't infer a scheduled frame until the sizes of the packets coded since the last inferred frame, relative to the key frame size, add up to <ratio>. Small P-frames mean little motion. 0.1 is a good start for fixed cameras. No pixel is read for it. The skipped frames are counted in the statistics (-stat). 0 (default) disables it\n"));
+	msdk_printf(MSDK_STRING("  -infer::roi <x,y,w,h[;x,y,w,h...]>  Face and vehicle detection infer only these regions of the decoded frame, each one resized to the network input on its own. The results are rendered on the whole frame. With -infer::requests, each region keeps its own latest completed results\n"));
+	msdk_printf(MSDK_STRING("  -infer::tiles <cols>x<rows>  Face and vehicle detection split the frame into a grid of overlapping tiles, detect each tile at the network input size and merge the detections. Small objects of 4K frames are then still detected. The tiles are inferred as one batch, or on parallel requests with -infer::preproc ie. -infer::batch is ignored. 1x1 by default\n"));
+	msdk_printf(MSDK_STRING("  -infer::tile_overlap <fraction>  Overlap of adjacent tiles relative to the tile size, below 0.5. An object on a tile border is whole in one of the tiles if it's smaller than the overlap. 0.15 by default\n"));
+	msdk_printf(MSDK_STRING("  -infer::mosaic               Face and vehicle detection run once for all the sessions with this option on a mosaic of their downscaled frames, placed by -vpp_comp_dst_x/y/w/h like in the composition, and the detections go back to the session of the tile they are in. Ignored with -infer::tiles\n"));
+	msdk_printf(MSDK_STRING("  -infer::requests <number>    Number of inference requests kept in flight. With more than one, a frame's inference doesn't wait for the previous one and the results of the latest completed frame are rendered. 1 by default. Ignored with -infer::batch\n"));
 	msdk_printf(MSDK_STRING("  -infer::max_detect <number>  Set the maximum number of detected objects. If there are more objects detected, they won't be processed further, i.e. classification or drawing box\n)"));
+	msdk_printf(MSDK_STRING("  -infer::async_depth <number> Run inference in a separate thread fed by a queue of <number> decoded surfaces, so decoding doesn't wait for inference. By default it's 0 and inference runs in the decoding thread\n"));
+	msdk_printf(MSDK_STRING("  -infer::batch <number>       Infer the frames of all the sessions running the same model in batches of up to <number> frames on one shared network. By default it's 1 and each session runs its own network\n"));
+	msdk_printf(MSDK_STRING("  -infer::batch_timeout <ms>   The maximum time a frame waits for its batch to fill when -infer::batch is used. 10ms by default\n"));
+	msdk_printf(MSDK_STRING("  -infer::preproc <cpu, ie>    Where the frames are resized and converted for the inference. cpu (default) does it in one pass on the CPU, ie hands the frame to the inference plugin without any copy. With ie the frame is in use until its inference completes, so -infer::requests has no effect. Ignored with -infer::batch\n"));
+	msdk_printf(MSDK_STRING("  -infer::tracking             On the frames between two inferred frames, move the rendered results with the objects instead of drawing them where they were last inferred. Allows higher -infer::interval values\n"));
+	msdk_printf(MSDK_STRING("  -infer::cache_dir <dir>      Keep the compiled inference networks in <dir> and import them on the next run instead of compiling them again. The directory applies to all the sessions, the sessions that set it must use the same one\n"));
+	msdk_printf(MSDK_STRING("  -infer::cascade <xml>        Run the small SSD detector <xml> on the frames to infer first, and run the model of -infer::fd/hp/vd only on the frames where it detects something. The other frames have no results\n"));
+	msdk_printf(MSDK_STRING("  -infer::cascade_threshold <confidence>  The confidence of a detection of -infer::cascade that runs the model of the frame, 0.5 by default\n"));
+	msdk_printf(MSDK_STRING("  -infer::hp_crops <number>    Human pose infers square crops around the people found instead of the whole frame while they are few and small, and the whole frame every <number> inferred frames or when a person is lost. 0 (default) always infers the whole frame\n"));
     msdk_printf(MSDK_STRING("\n"));
     msdk_printf(MSDK_STRING("ParFile format:\n"));
     msdk_printf(MSDK_STRING("  ParFile is extension of what can be achieved by setting pipeline in the command\n"));
@@ -1423,6 +1441,19 @@ mfxStatus ParseVPPCmdLine(msdk_char *argv[], mfxU32 argc, mfxU32& index, Transco
     return MFX_ERR_MORE_DATA;
 }
 
+// The first inference mode of a session is InferType, the other ones run on the same frames
+void AddInferType(TranscodingSample::sInputParams& InputParams, int type)
+{
+    if (InputParams.InferType == MediaInferenceManager::InferTypeNone || InputParams.InferType == type)
+    {
+        InputParams.InferType = type;
+    }
+    else if (std::find(InputParams.InferExtraTypes.begin(), InputParams.InferExtraTypes.end(), type) == InputParams.InferExtraTypes.end())
+    {
+        InputParams.InferExtraTypes.push_back(type);
+    }
+}
+
 mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char *argv[])
 {
     mfxStatus sts = MFX_ERR_NONE;
@@ -1961,25 +1992,49 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char *argv[])
 		{
 			INFER_PAR_MODEL,
 			INFER_PAR_OFFLINE,
+			INFER_PAR_TRACKING,
 			INFER_PAR_DEVICE,
 			INFER_PAR_INTERVAL,
-			INFER_PAR_MAX_DETECT
+			INFER_PAR_INTERVAL_MIN,
+			INFER_PAR_INTERVAL_MAX,
+			INFER_PAR_RATE,
+			INFER_PAR_MOTION_THRESHOLD,
+			INFER_PAR_ACTIVITY_THRESHOLD,
+			INFER_PAR_ROI,
+			INFER_PAR_TILES,
+			INFER_PAR_TILE_OVERLAP,
+			INFER_PAR_MOSAIC,
+			INFER_PAR_MAX_DETECT,
+			INFER_PAR_ASYNC_DEPTH,
+			INFER_PAR_BATCH,
+			INFER_PAR_BATCH_TIMEOUT,
+			INFER_PAR_REQUESTS,
+			INFER_PAR_CACHE_DIR,
+			INFER_PAR_CASCADE,
+			INFER_PAR_CASCADE_THRESHOLD,
+			INFER_PAR_HP_CROPS,
+			INFER_PAR_PREPROC
 		} inferParType;
-		if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("fd"), msdk_strlen(MSDK_STRING("fd")))) //Face detection
+		// Before "hp", which is its prefix
+		if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("hp_crops"), msdk_strlen(MSDK_STRING("hp_crops"))))
 		{
-			InputParams.InferType = MediaInferenceManager::InferTypeFaceDetection;
+			inferParType = INFER_PAR_HP_CROPS;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("fd"), msdk_strlen(MSDK_STRING("fd")))) //Face detection
+		{
+			AddInferType(InputParams, MediaInferenceManager::InferTypeFaceDetection);
 			inferParType = INFER_PAR_MODEL;
 			msdk_printf(MSDK_STRING("Inference: Face Detection. Model directory %s \n"), argv[i + 1]);
 		}
 		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("hp"), msdk_strlen(MSDK_STRING("hp")))) //Human Pose
 		{
-			InputParams.InferType = MediaInferenceManager::InferTypeHumanPoseEst;
+			AddInferType(InputParams, MediaInferenceManager::InferTypeHumanPoseEst);
 			msdk_printf(MSDK_STRING("Inference: Human Pose Estimation. Model directory %s \n"), argv[i + 1]);
 			inferParType = INFER_PAR_MODEL;
 		}
 		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("vd"), msdk_strlen(MSDK_STRING("vd")))) //Vehicle Detect
 		{
-			InputParams.InferType = MediaInferenceManager::InferTypeVADetect;
+			AddInferType(InputParams, MediaInferenceManager::InferTypeVADetect);
 			inferParType = INFER_PAR_MODEL;
 			msdk_printf(MSDK_STRING("Inference: Vehicle and Attribute Detect. Model directory %s \n"), argv[i + 1]);
 		}
@@ -1989,18 +2044,93 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char *argv[])
 			inferParType = INFER_PAR_OFFLINE;
 			msdk_printf(MSDK_STRING("Offline inference is enabled\n"));
 		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("tracking"), msdk_strlen(MSDK_STRING("tracking"))))
+		{
+			InputParams.InferTracking = true;
+			inferParType = INFER_PAR_TRACKING;
+			msdk_printf(MSDK_STRING("Inference results tracking is enabled\n"));
+		}
 		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("device"), msdk_strlen(MSDK_STRING("device"))))
 		{
 			inferParType = INFER_PAR_DEVICE;
 		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("interval_min"), msdk_strlen(MSDK_STRING("interval_min"))))
+		{
+			inferParType = INFER_PAR_INTERVAL_MIN;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("interval_max"), msdk_strlen(MSDK_STRING("interval_max"))))
+		{
+			inferParType = INFER_PAR_INTERVAL_MAX;
+		}
 		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("interval"), msdk_strlen(MSDK_STRING("interval"))))
 		{
 			inferParType = INFER_PAR_INTERVAL;
 		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("rate"), msdk_strlen(MSDK_STRING("rate"))))
+		{
+			inferParType = INFER_PAR_RATE;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("motion_threshold"), msdk_strlen(MSDK_STRING("motion_threshold"))))
+		{
+			inferParType = INFER_PAR_MOTION_THRESHOLD;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("activity_threshold"), msdk_strlen(MSDK_STRING("activity_threshold"))))
+		{
+			inferParType = INFER_PAR_ACTIVITY_THRESHOLD;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("roi"), msdk_strlen(MSDK_STRING("roi"))))
+		{
+			inferParType = INFER_PAR_ROI;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("tiles"), msdk_strlen(MSDK_STRING("tiles"))))
+		{
+			inferParType = INFER_PAR_TILES;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("tile_overlap"), msdk_strlen(MSDK_STRING("tile_overlap"))))
+		{
+			inferParType = INFER_PAR_TILE_OVERLAP;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("mosaic"), msdk_strlen(MSDK_STRING("mosaic"))))
+		{
+			InputParams.InferMosaic = true;
+			inferParType = INFER_PAR_MOSAIC;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("requests"), msdk_strlen(MSDK_STRING("requests"))))
+		{
+			inferParType = INFER_PAR_REQUESTS;
+		}
 		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("max_detect"), msdk_strlen(MSDK_STRING("max_detect"))))
 		{
 			inferParType = INFER_PAR_MAX_DETECT;
 		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("async_depth"), msdk_strlen(MSDK_STRING("async_depth"))))
+		{
+			inferParType = INFER_PAR_ASYNC_DEPTH;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("preproc"), msdk_strlen(MSDK_STRING("preproc"))))
+		{
+			inferParType = INFER_PAR_PREPROC;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("cache_dir"), msdk_strlen(MSDK_STRING("cache_dir"))))
+		{
+			inferParType = INFER_PAR_CACHE_DIR;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("cascade_threshold"), msdk_strlen(MSDK_STRING("cascade_threshold"))))
+		{
+			inferParType = INFER_PAR_CASCADE_THRESHOLD;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("cascade"), msdk_strlen(MSDK_STRING("cascade"))))
+		{
+			inferParType = INFER_PAR_CASCADE;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("batch_timeout"), msdk_strlen(MSDK_STRING("batch_timeout"))))
+		{
+			inferParType = INFER_PAR_BATCH_TIMEOUT;
+		}
+		else if (0 == msdk_strncmp(argv[i] + 8, MSDK_STRING("batch"), msdk_strlen(MSDK_STRING("batch"))))
+		{
+			inferParType = INFER_PAR_BATCH;
+		}
 		else
 		{
 			msdk_printf(MSDK_STRING("error: Inference option only support fd(face detection) or hf(human pose)\n"));
@@ -2016,6 +2146,60 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char *argv[])
 			msdk_opt_read(argv[i], InputParams.strIRFileDir);
 			break;
 
+		case INFER_PAR_PREPROC:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (0 == msdk_strcmp(argv[i], MSDK_STRING("cpu")))
+			{
+				InputParams.InferPreprocMode = InferPreprocess::ModeCPU;
+			}
+			else if (0 == msdk_strcmp(argv[i], MSDK_STRING("ie")))
+			{
+				InputParams.InferPreprocMode = InferPreprocess::ModeIE;
+			}
+			else
+			{
+				msdk_printf(MSDK_STRING("error: only cpu and ie are supported as inference preprocessing\n"));
+				return  MFX_ERR_UNSUPPORTED;
+			}
+			break;
+
+		case INFER_PAR_CACHE_DIR:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			SIZE_CHECK((msdk_strlen(argv[i]) + 1) > MSDK_ARRAY_LEN(InputParams.strInferCacheDir));
+			msdk_opt_read(argv[i], InputParams.strInferCacheDir);
+			break;
+
+		case INFER_PAR_CASCADE:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			SIZE_CHECK((msdk_strlen(argv[i]) + 1) > MSDK_ARRAY_LEN(InputParams.strInferCascadeModel));
+			msdk_opt_read(argv[i], InputParams.strInferCascadeModel);
+			break;
+
+		case INFER_PAR_CASCADE_THRESHOLD:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferCascadeThreshold)
+				|| InputParams.InferCascadeThreshold < 0 || InputParams.InferCascadeThreshold >= 1)
+			{
+				PrintError(MSDK_STRING("Inference cascade threshold \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+
+		case INFER_PAR_HP_CROPS:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferHPFullFrameInterval)
+				|| InputParams.InferHPFullFrameInterval < 0)
+			{
+				PrintError(MSDK_STRING("Human pose full frame interval \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+
 		case INFER_PAR_DEVICE:
 			VAL_CHECK(i + 1 == argc, i, argv[i]);
 			i++;
@@ -2046,6 +2230,98 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char *argv[])
 				return MFX_ERR_UNSUPPORTED;
 			}
 			break;
+		case INFER_PAR_INTERVAL_MIN:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferIntervalMin) || InputParams.InferIntervalMin < 1)
+			{
+				PrintError(MSDK_STRING("Inference minimum interval \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_INTERVAL_MAX:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferIntervalMax) || InputParams.InferIntervalMax < 1)
+			{
+				PrintError(MSDK_STRING("Inference maximum interval \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_RATE:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferRate) || InputParams.InferRate <= 0)
+			{
+				PrintError(MSDK_STRING("Inference rate \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_MOTION_THRESHOLD:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferMotionThreshold) || InputParams.InferMotionThreshold < 0)
+			{
+				PrintError(MSDK_STRING("Inference motion threshold \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_ROI:
+		{
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			// x,y,w,h[;x,y,w,h...]
+			msdk_stringstream rois(argv[i]);
+			for (msdk_string roi; std::getline(rois, roi, msdk_char(';'));)
+			{
+				int x = 0, y = 0, w = 0, h = 0;
+				if (4 != msdk_sscanf(roi.c_str(), MSDK_STRING("%d,%d,%d,%d"), &x, &y, &w, &h) || x < 0 || y < 0 || w <= 0 || h <= 0)
+				{
+					PrintError(MSDK_STRING("Inference region \"%s\" is invalid"), roi.c_str());
+					return MFX_ERR_UNSUPPORTED;
+				}
+				InputParams.InferRois.push_back(cv::Rect(x, y, w, h));
+			}
+			break;
+		}
+		case INFER_PAR_TILES:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (2 != msdk_sscanf(argv[i], MSDK_STRING("%dx%d"), &InputParams.InferTileCols, &InputParams.InferTileRows)
+				|| InputParams.InferTileCols < 1 || InputParams.InferTileRows < 1)
+			{
+				PrintError(MSDK_STRING("Inference tiles \"%s\" are invalid, expected <cols>x<rows>"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_TILE_OVERLAP:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferTileOverlap)
+				|| InputParams.InferTileOverlap < 0 || InputParams.InferTileOverlap >= 0.5)
+			{
+				PrintError(MSDK_STRING("Inference tile overlap \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_ACTIVITY_THRESHOLD:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferActivityThreshold) || InputParams.InferActivityThreshold < 0)
+			{
+				PrintError(MSDK_STRING("Inference activity threshold \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_REQUESTS:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferRequests) || InputParams.InferRequests < 1)
+			{
+				PrintError(MSDK_STRING("Inference requests number \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
 		case INFER_PAR_MAX_DETECT:
 			VAL_CHECK(i + 1 == argc, i, argv[i]);
 			i++;
@@ -2055,7 +2331,36 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char *argv[])
 				return MFX_ERR_UNSUPPORTED;
 			}
 			break;
+		case INFER_PAR_ASYNC_DEPTH:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferAsyncDepth) || InputParams.InferAsyncDepth < 0)
+			{
+				PrintError(MSDK_STRING("Inference async depth \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_BATCH:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferBatch) || InputParams.InferBatch < 1)
+			{
+				PrintError(MSDK_STRING("Inference batch size \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
+		case INFER_PAR_BATCH_TIMEOUT:
+			VAL_CHECK(i + 1 == argc, i, argv[i]);
+			i++;
+			if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.InferBatchTimeout) || InputParams.InferBatchTimeout < 0)
+			{
+				PrintError(MSDK_STRING("Inference batch timeout \"%s\" is invalid"), argv[i]);
+				return MFX_ERR_UNSUPPORTED;
+			}
+			break;
 		case INFER_PAR_OFFLINE:
+		case INFER_PAR_TRACKING:
+		case INFER_PAR_MOSAIC:
 			break;
 		default:
 			msdk_printf(MSDK_STRING("error: Inference option only support fd(face detection)  hf(human pose), offline(not rendering results), device <target_device>, interval, and max_detect <number>)\n"));
@@ -7,12 +7,20 @@
 #include <vector>
 #include <chrono>
 #include <mutex>
+#include <future>
+#include <iostream>
+#include <utility>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <samples/ocv_common.hpp>
 #include <samples/common.hpp>
 
 #include "vehicle_detect.hpp"
+#include "infer_server.h"
+#include "infer_request_pool.h"
+#include "infer_network_registry.h"
+#include "infer_frame_blob.h"
+#include "ssd_decoder.h"
 
 
 using namespace InferenceEngine;
@@ -26,15 +34,104 @@ VehicleDetect::VehicleDetect(bool enablePerformanceReport)
 
 void VehicleDetect::Init(const std::string& detectorModelPath,
         const std::string& vehicleAttribsModelPath,
-        const std::string& targetDeviceName)
-{
-    static std::mutex initLock;
-    std::lock_guard<std::mutex> lock(initLock);
-	InferenceEngine::Core ie;
-	InferenceEngine::Core ie1;
-	mDetectorNetwork = ie.ReadNetwork(detectorModelPath);
-    InferenceEngine::InputInfo::Ptr inputInfo = mDetectorNetwork.getInputsInfo().begin()->second;
-    inputInfo->setPrecision(Precision::U8);
+        const std::string& targetDeviceName,
+        int maxBatch, int maxWaitMs, int numRequests, InferPreprocess::Mode preprocMode,
+        InferPreprocess::Format frameFormat, int maxObjNum)
+{
+    if (mTiles.IsEnabled())
+    {
+        maxBatch = 1;
+        mMosaic = false;
+    }
+    mPreprocMode = (maxBatch > 1 || mMosaic) ? InferPreprocess::ModeCPU : preprocMode;
+    const bool pluginPreproc = (mPreprocMode == InferPreprocess::ModeIE);
+    // The vehicles of a frame are classified together, except with the plugin resizing each vehicle
+    // from its own wrapped frame blob
+    mVABatchSize = 1;
+    if (!pluginPreproc)
+    {
+        mVABatchSize = (maxObjNum > 0) ? std::min(maxObjNum, static_cast<int>(mVAMaxBatch)) : mVAMaxBatch;
+    }
+    const int VABatchSize = mVABatchSize;
+    // The attributes network loads while the detection network is loading. The second is whether
+    // the plugin runs partial batches at their size
+    typedef std::pair<std::shared_ptr<InferNetworkRegistry::Entry>, bool> VANetworkLoad;
+    std::future<VANetworkLoad> VALoading = std::async(std::launch::async,
+        [&vehicleAttribsModelPath, &targetDeviceName, pluginPreproc, frameFormat, VABatchSize]() {
+            auto load = [&](int batchSize, const std::map<std::string, std::string>& config) {
+                std::string tag = "batch" + std::to_string(batchSize);
+                if (pluginPreproc)
+                {
+                    tag += "|" + InferFrameBlob::NetworkTag(frameFormat);
+                }
+                return InferNetworkRegistry::Load(vehicleAttribsModelPath, targetDeviceName, tag,
+                    [pluginPreproc, frameFormat, batchSize](CNNNetwork& network) {
+                        SetupVANetwork(network, batchSize);
+                        if (pluginPreproc)
+                        {
+                            InferFrameBlob::SetupInput(network.getInputsInfo().begin()->second, frameFormat);
+                        }
+                    }, config);
+            };
+            if (VABatchSize > 1)
+            {
+                try
+                {
+                    return VANetworkLoad(load(VABatchSize,
+                        {{PluginConfigParams::KEY_DYN_BATCH_ENABLED, PluginConfigParams::YES}}), true);
+                }
+                catch (const std::exception &)
+                {
+                    // Not every plugin supports dynamic batch. A full batch for every frame would cost up
+                    // to mVAMaxBatch times one vehicle, the vehicles are classified one at a time instead
+                }
+            }
+            return VANetworkLoad(load(1, {}), false);
+        });
+    if (mMosaic)
+    {
+        // The sessions of the mosaic fill their tiles of one input
+        mServer = InferServer::Get(detectorModelPath, targetDeviceName, "", InferServer::MosaicMaxTiles, maxWaitMs,
+            SetupDetectorNetwork, true);
+        mDetectorNetwork = mServer->Network();
+    }
+    else if (maxBatch > 1)
+    {
+        // Frames of all the sessions using this model are batched by one shared server
+        mServer = InferServer::Get(detectorModelPath, targetDeviceName, "", maxBatch, maxWaitMs, SetupDetectorNetwork);
+        mDetectorNetwork = mServer->Network();
+    }
+    else
+    {
+        // The networks are shared by all the sessions, each session only has its own requests.
+        // The tiles of a frame are one batch, except for the plugin resizing each tile from its own blob
+        const int batchSize = (mTiles.IsEnabled() && !pluginPreproc) ? mTiles.Count() : 0;
+        std::string tag = pluginPreproc ? InferFrameBlob::NetworkTag(frameFormat) : "";
+        if (batchSize > 0)
+        {
+            tag = "batch" + std::to_string(batchSize);
+        }
+        mDetectorEntry = InferNetworkRegistry::Load(detectorModelPath, targetDeviceName, tag,
+            [pluginPreproc, frameFormat, batchSize](CNNNetwork& network) {
+                SetupDetectorNetwork(network);
+                if (batchSize > 0)
+                {
+                    network.setBatchSize(batchSize);
+                }
+                if (pluginPreproc)
+                {
+                    InferFrameBlob::SetupInput(network.getInputsInfo().begin()->second, frameFormat);
+                }
+            });
+        mDetectorNetwork = mDetectorEntry->network;
+    }
+    mDetectorInputName = mDetectorNetwork.getInputsInfo().begin()->first;
+    const SizeVector detectorInputDims = mDetectorNetwork.getInputsInfo().begin()->second->getTensorDesc().getDims();
+    mDetectorInputSize = cv::Size(static_cast<int>(detectorInputDims[3]), static_cast<int>(detectorInputDims[2]));
+    if (mMosaic)
+    {
+        mMosaicRect = DetectionTiles::MosaicRect(mMosaicTile, mDetectorInputSize);
+    }
 
     InferenceEngine::OutputsDataMap outputInfo = mDetectorNetwork.getOutputsInfo();
     auto outputBlobsIt = outputInfo.begin();
@@ -45,25 +142,89 @@ void VehicleDetect::Init(const std::string& detectorModelPath,
     mDetectorOutputName = outputInfo.begin()->first;
     mDetectorMaxProposalCount = outputDims[2];
     mDetectorObjectSize = outputDims[3];
-    output->setPrecision(Precision::FP32);
-    output->setLayout(Layout::NCHW);
+    if (mDetectorObjectSize != SsdDecoder::DetectionSize)
+    {
+        throw std::logic_error("Vehicle detection output should have 7 as a last dimension");
+    }
 
-	mVDExecutableNetwork = ie.LoadNetwork(mDetectorNetwork, targetDeviceName);
-    mDetectorRequest = mVDExecutableNetwork.CreateInferRequest();
+    if (!mServer)
+    {
+        if (mTiles.IsEnabled() && pluginPreproc)
+        {
+            numRequests = std::max(numRequests, mTiles.Count());
+        }
+        mRequests.Init(mDetectorEntry->executableNetwork, numRequests);
+    }
+    else
+    {
+        numRequests = 1;
+    }
+    mSlotFrames.resize(numRequests);
+    mSlotPixels.resize(numRequests);
+    mSlotClassifications.resize(numRequests);
 
-	mVANetwork = ie1.ReadNetwork(vehicleAttribsModelPath);
-    mVANetwork.setBatchSize(1);
-    inputInfo = mVANetwork.getInputsInfo().begin()->second;
-    inputInfo->setPrecision(Precision::U8);
-    inputInfo->getInputData()->setLayout(Layout::NCHW);
+    const VANetworkLoad VALoaded = VALoading.get();
+    mVAEntry = VALoaded.first;
+    mVADynBatch = VALoaded.second;
+    mVABatchSize = mVADynBatch ? VABatchSize : 1;
+    mVANetwork = mVAEntry->network;
 
     outputInfo = mVANetwork.getOutputsInfo();
     outputBlobsIt = outputInfo.begin();
     mVAOutputNameForColor = (outputBlobsIt++)->second->getName();  // color is the first output
     mVAOutputNameForType = (outputBlobsIt++)->second->getName();  // type is the second output
 
-	mVAExecutableNetwork = ie1.LoadNetwork(mVANetwork, targetDeviceName);
-    mVARequest = mVAExecutableNetwork.CreateInferRequest();
+    mVAInputName = mVANetwork.getInputsInfo().begin()->first;
+    const SizeVector VAInputDims = mVANetwork.getInputsInfo().begin()->second->getTensorDesc().getDims();
+    mVAInputSize = cv::Size(static_cast<int>(VAInputDims[3]), static_cast<int>(VAInputDims[2]));
+    // Each detection request classifies its vehicles with its own attributes request
+    mVARequests.resize(numRequests);
+    for (size_t slot = 0; slot < mVARequests.size(); slot++)
+    {
+        mVARequests[slot] = mVAEntry->executableNetwork.CreateInferRequest();
+        // The other paths classify with Infer() in the session thread
+        if (!mServer && !mTiles.IsEnabled())
+        {
+            mVARequests[slot].SetCompletionCallback(
+                std::function<void(InferRequest, StatusCode)>([this, slot](InferRequest, StatusCode status) {
+                    OnClassified(slot, status);
+                }));
+        }
+    }
+}
+
+void VehicleDetect::SetTiles(int cols, int rows, float overlap)
+{
+    mTiles.Set(cols, rows, overlap);
+}
+
+void VehicleDetect::SetInputCache(InferInputCache* cache)
+{
+    mInputCache = cache;
+}
+
+void VehicleDetect::SetMosaic(const cv::Rect2f& tile)
+{
+    mMosaic = true;
+    mMosaicTile = tile;
+}
+
+void VehicleDetect::SetupDetectorNetwork(InferenceEngine::CNNNetwork& network)
+{
+    InferenceEngine::InputInfo::Ptr inputInfo = network.getInputsInfo().begin()->second;
+    inputInfo->setPrecision(Precision::U8);
+
+    DataPtr& output = network.getOutputsInfo().begin()->second;
+    output->setPrecision(Precision::FP32);
+    output->setLayout(Layout::NCHW);
+}
+
+void VehicleDetect::SetupVANetwork(InferenceEngine::CNNNetwork& network, int batchSize)
+{
+    network.setBatchSize(batchSize);
+    InferenceEngine::InputInfo::Ptr inputInfo = network.getInputsInfo().begin()->second;
+    inputInfo->setPrecision(Precision::U8);
+    inputInfo->getInputData()->setLayout(Layout::NCHW);
 }
 
 const std::string VehicleDetect::mVAColors[] =
@@ -81,84 +242,343 @@ void VehicleDetect::SetSrcImageSize(int width, int height)
     mSrcImageSize.width = width;
 }
 
-void VehicleDetect::Detect(const cv::Mat& image, std::vector<VehicleDetectResult>& results, int maxObjNum)
+void VehicleDetect::Detect(const InferPreprocess::Frame& frame, std::vector<VehicleDetectResult>& results, int maxObjNum,
+        int region)
 {
-    InferenceEngine::Blob::Ptr input = mDetectorRequest.GetBlob(mDetectorNetwork.getInputsInfo().begin()->first);
-    matU8ToBlob<uint8_t>(image, input);
-    mDetectorRequest.Infer();
-
-    const float *detections = mDetectorRequest.GetBlob(mDetectorOutputName)->buffer().as<float *>();
     if (maxObjNum < 0 || maxObjNum > mDetectorMaxProposalCount)
     {
         maxObjNum = mDetectorMaxProposalCount; 
     }
+    if (mTiles.IsEnabled())
+    {
+        DetectTiles(frame, results, maxObjNum);
+        return;
+    }
+    const size_t planeSize = static_cast<size_t>(mDetectorInputSize.area());
+    const cv::Size frameSize(frame.width, frame.height);
+    // The server paths parse the detections of this frame only, whatever the caller passes in results
+    std::vector<VehicleDetectResult> objects;
 
-    for (int i = 0; i < mDetectorMaxProposalCount; i++)
+    if (mServer && mMosaic)
     {
-        float image_id = detections[i * mDetectorObjectSize + 0];  // in case of batch
-        VehicleDetectResult r;
-        r.label = static_cast<int>(detections[i * mDetectorObjectSize + 1]);
-        r.confidence = detections[i * mDetectorObjectSize + 2];
-        if (r.confidence <= mDetectThreshold || r.label != 1)
+        // Resize here so the server thread only copies the planes into the tile
+        const size_t tileSize = static_cast<size_t>(mMosaicRect.area());
+        mInputPlanes.resize(3 * tileSize);
+        InferInputCache::ResizeToPlanarBGR(mInputCache, frame, mInputPlanes.data(),
+            mMosaicRect.width, mMosaicRect.height, mMosaicRect.width, tileSize);
+        mServer->Infer(
+            [this](Blob::Ptr& input, size_t) {
+                DetectionTiles::CopyToMosaic(mInputPlanes.data(), mMosaicRect, input->buffer().as<uint8_t *>(),
+                    mDetectorInputSize);
+            },
+            [this, &objects, maxObjNum, frameSize](InferRequest& request, size_t batchIdx) {
+                ParseDetections(request.GetBlob(mDetectorOutputName)->buffer().as<float *>(),
+                    static_cast<int>(batchIdx), frameSize, objects, maxObjNum);
+            });
+        results.swap(objects);
+    }
+    else if (mServer)
+    {
+        // Resize here so the server thread only copies the planes into its batch slot
+        mInputPlanes.resize(3 * planeSize);
+        InferInputCache::ResizeToPlanarBGR(mInputCache, frame, mInputPlanes.data(),
+            mDetectorInputSize.width, mDetectorInputSize.height, mDetectorInputSize.width, planeSize);
+        mServer->Infer(
+            [this](Blob::Ptr& input, size_t batchIdx) {
+                std::copy(mInputPlanes.begin(), mInputPlanes.end(),
+                    input->buffer().as<uint8_t *>() + batchIdx * mInputPlanes.size());
+            },
+            [this, &objects, maxObjNum, frameSize](InferRequest& request, size_t batchIdx) {
+                ParseDetections(request.GetBlob(mDetectorOutputName)->buffer().as<float *>(),
+                    static_cast<int>(batchIdx), frameSize, objects, maxObjNum);
+            });
+        results.swap(objects);
+    }
+    else
+    {
+        size_t slot = mRequests.Acquire();
+        if (mPreprocMode == InferPreprocess::ModeIE)
         {
-            continue;
+            mRequests.Request(slot).SetBlob(mDetectorInputName, InferFrameBlob::Wrap(frame));
+        }
+        else
+        {
+            InferenceEngine::Blob::Ptr input = mRequests.Request(slot).GetBlob(mDetectorInputName);
+            InferInputCache::ResizeToPlanarBGR(mInputCache, frame, input->buffer().as<uint8_t *>(),
+                mDetectorInputSize.width, mDetectorInputSize.height, mDetectorInputSize.width, planeSize);
+        }
+        // The caller reuses the frame once Detect() returns, keep a copy for the classification
+        if (mRequests.Depth() > 1 && mPreprocMode != InferPreprocess::ModeIE)
+        {
+            mSlotFrames[slot] = InferPreprocess::Copy(frame, mSlotPixels[slot]);
+        }
+        else
+        {
+            mSlotFrames[slot] = frame;
+        }
+        unsigned int seq = ++mSubmitted;
+        mRequests.StartAsync(slot, [this, seq, region, maxObjNum, frameSize](InferRequest& request, size_t slot) {
+            SlotClassification& classification = mSlotClassifications[slot];
+            classification.seq = seq;
+            classification.region = region;
+            classification.objects.clear();
+            ParseDetections(request.GetBlob(mDetectorOutputName)->buffer().as<float *>(),
+                0, frameSize, classification.objects, maxObjNum);
+            CollectVehicles(mSlotFrames[slot], classification.objects, classification.indices,
+                classification.vehicles);
+            // Blocking on the attributes here would stall the callback thread of the plugin
+            classification.first = 0;
+            classification.count = 0;
+            mRequests.Hold(slot);
+            ClassifyNextBatch(slot);
+        });
+        if (mRequests.Depth() == 1 || mPreprocMode == InferPreprocess::ModeIE)
+        {
+            // The plugin reads the wrapped frame while it infers, and the frame is reused after Detect()
+            mRequests.WaitAll();
         }
 
-        if (image_id < 0)
-        {  // indicates end of detections
+        // With more requests these are the results of the latest completed frame, in the same region
+        std::lock_guard<std::mutex> lock(mResultsLock);
+        results = mLatestResults[region].objects;
+        return;
+    }
+
+    Classify(frame, results, mVARequests[0]);
+}
+
+void VehicleDetect::DetectTiles(const InferPreprocess::Frame& frame, std::vector<VehicleDetectResult>& results,
+        int maxObjNum)
+{
+    const std::vector<cv::Rect> tiles = mTiles.Split(frame.width, frame.height);
+    const cv::Size tileSize = tiles[0].size();
+    std::vector<std::vector<VehicleDetectResult>> tileObjects(tiles.size());
+
+    if (mPreprocMode == InferPreprocess::ModeIE)
+    {
+        for (size_t t = 0; t < tiles.size(); t++)
+        {
+            size_t slot = mRequests.Acquire();
+            mRequests.Request(slot).SetBlob(mDetectorInputName,
+                InferFrameBlob::Wrap(frame.Roi(tiles[t].x, tiles[t].y, tiles[t].width, tiles[t].height)));
+            mRequests.StartAsync(slot, [this, t, tileSize, &tileObjects](InferRequest& request, size_t) {
+                ParseDetections(request.GetBlob(mDetectorOutputName)->buffer().as<float *>(),
+                    0, tileSize, tileObjects[t], mDetectorMaxProposalCount);
+            });
+        }
+    }
+    else
+    {
+        const size_t planeSize = static_cast<size_t>(mDetectorInputSize.area());
+        size_t slot = mRequests.Acquire();
+        uint8_t *input = mRequests.Request(slot).GetBlob(mDetectorInputName)->buffer().as<uint8_t *>();
+        for (size_t t = 0; t < tiles.size(); t++)
+        {
+            InferPreprocess::ResizeToPlanarBGR(frame.Roi(tiles[t].x, tiles[t].y, tiles[t].width, tiles[t].height),
+                input + t * 3 * planeSize, mDetectorInputSize.width, mDetectorInputSize.height,
+                mDetectorInputSize.width, planeSize);
+        }
+        mRequests.StartAsync(slot, [this, tileSize, &tileObjects](InferRequest& request, size_t) {
+            const float *detections = request.GetBlob(mDetectorOutputName)->buffer().as<float *>();
+            for (size_t t = 0; t < tileObjects.size(); t++)
+            {
+                ParseDetections(detections, static_cast<int>(t), tileSize, tileObjects[t], mDetectorMaxProposalCount);
+            }
+        });
+    }
+    mRequests.WaitAll();
+
+    // The vehicles on the overlaps are detected in more than one tile
+    std::vector<VehicleDetectResult> objects;
+    std::vector<cv::Rect> boxes;
+    std::vector<float> scores;
+    for (size_t t = 0; t < tiles.size(); t++)
+    {
+        for (VehicleDetectResult& object : tileObjects[t])
+        {
+            object.location += tiles[t].tl();
+            objects.push_back(object);
+            boxes.push_back(object.location);
+            scores.push_back(object.confidence);
+        }
+    }
+    results.clear();
+    for (size_t i : DetectionTiles::NonMaxSuppression(boxes, scores))
+    {
+        if (results.size() >= (size_t)maxObjNum)
+        {
             break;
         }
-        r.location.x = static_cast<int>(detections[i * mDetectorObjectSize + 3] * mSrcImageSize.width);
-        r.location.y = static_cast<int>(detections[i * mDetectorObjectSize + 4] * mSrcImageSize.height);
-        r.location.width = static_cast<int>(detections[i * mDetectorObjectSize + 5] * mSrcImageSize.width - r.location.x);
-        r.location.height = static_cast<int>(detections[i * mDetectorObjectSize + 6] * mSrcImageSize.height - r.location.y);
+        results.push_back(objects[i]);
+    }
+    Classify(frame, results, mVARequests[0]);
+}
 
-        /* std::cout << "[" << i << "," << r.label << "] element, prob = " << r.confidence <<
-            "    (" << r.location.x << "," << r.location.y << ")-(" << r.location.width << ","
-            << r.location.height << ")"
-            << (r.confidence  ) << std::endl; */
+void VehicleDetect::Classify(const InferPreprocess::Frame& frame, std::vector<VehicleDetectResult>& results,
+        InferenceEngine::InferRequest& VARequest)
+{
+    std::vector<size_t> indices;
+    std::vector<InferPreprocess::Frame> vehicles;
+    CollectVehicles(frame, results, indices, vehicles);
+    for (size_t first = 0; first < vehicles.size();)
+    {
+        const size_t count = FillVABatch(VARequest, vehicles, first);
+        VARequest.Infer();
+        ReadVABatch(VARequest, results, indices, first, count);
+        first += count;
+    }
+}
 
-        results.push_back(r);
-        if (results.size() >= (unsigned int)maxObjNum)
+void VehicleDetect::CollectVehicles(const InferPreprocess::Frame& frame, const std::vector<VehicleDetectResult>& results,
+        std::vector<size_t>& indices, std::vector<InferPreprocess::Frame>& vehicles) const
+{
+    indices.clear();
+    vehicles.clear();
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        auto clip = results[i].location & cv::Rect(0, 0, frame.width, frame.height);
+        if (clip.area() <= 0)
         {
-            break;
+            continue;
         }
+        indices.push_back(i);
+        vehicles.push_back(frame.Roi(clip.x, clip.y, clip.width, clip.height));
     }
+}
 
-    InferenceEngine::Blob::Ptr VAInput = mVARequest.GetBlob(mVANetwork.getInputsInfo().begin()->first);
-    for (unsigned int i = 0; i < results.size(); i++)
+size_t VehicleDetect::FillVABatch(InferenceEngine::InferRequest& VARequest,
+        const std::vector<InferPreprocess::Frame>& vehicles, size_t first)
+{
+    const size_t count = std::min(vehicles.size() - first, static_cast<size_t>(mVABatchSize));
+    if (mPreprocMode == InferPreprocess::ModeIE)
+    {
+        // The batch size is 1
+        VARequest.SetBlob(mVAInputName, InferFrameBlob::Wrap(vehicles[first]));
+    }
+    else
     {
-        //image's size can be different from source image
-        auto clip = results[i].location & cv::Rect(0, 0, mSrcImageSize.width, mSrcImageSize.height);
-        clip.x = clip.x * image.cols / mSrcImageSize.width;
-        clip.width = clip.width * image.cols / mSrcImageSize.width;
-        clip.y = clip.y * image.rows / mSrcImageSize.height;
-        clip.height = clip.height * image.rows / mSrcImageSize.height;
-        cv::Mat vehicle = image(clip);
-        matU8ToBlob<uint8_t>(vehicle, VAInput);
-        mVARequest.Infer();
+        // Each vehicle is resized straight from the frame into its slot of the input blob
+        const size_t planeSize = static_cast<size_t>(mVAInputSize.area());
+        uint8_t *input = VARequest.GetBlob(mVAInputName)->buffer().as<uint8_t *>();
+        for (size_t j = 0; j < count; j++)
+        {
+            InferPreprocess::ResizeToPlanarBGR(vehicles[first + j], input + j * 3 * planeSize,
+                mVAInputSize.width, mVAInputSize.height, mVAInputSize.width, planeSize);
+        }
+    }
+    if (mVADynBatch)
+    {
+        VARequest.SetBatch(static_cast<int>(count));
+    }
+    return count;
+}
+
+void VehicleDetect::ReadVABatch(InferenceEngine::InferRequest& VARequest, std::vector<VehicleDetectResult>& results,
+        const std::vector<size_t>& indices, size_t first, size_t count) const
+{
+    // 7 colors and 4 types for each vehicle, we select the ones with the maximum probability
+    const float *colorsValues = VARequest.GetBlob(mVAOutputNameForColor)->buffer().as<float*>();
+    const float *typesValues = VARequest.GetBlob(mVAOutputNameForType)->buffer().as<float*>();
+    for (size_t j = 0; j < count; j++)
+    {
+        const float *colors = colorsValues + j * 7;
+        const float *types = typesValues + j * 4;
+        VehicleDetectResult& result = results[indices[first + j]];
+        result.color = mVAColors[std::max_element(colors, colors + 7) - colors];
+        result.type = mVATypes[std::max_element(types, types + 4) - types];
+    }
+}
+
+void VehicleDetect::ClassifyNextBatch(size_t slot)
+{
+    SlotClassification& classification = mSlotClassifications[slot];
+    classification.first += classification.count;
+    if (classification.first < classification.vehicles.size())
+    {
+        try
+        {
+            classification.count = FillVABatch(mVARequests[slot], classification.vehicles, classification.first);
+            mVARequests[slot].StartAsync();
+            return;
+        }
+        catch (const std::exception& e)
+        {
+            // The vehicles left keep no attributes
+            std::cerr << "[ ERROR ] Vehicle attributes inference failed: " << e.what() << std::endl;
+        }
+    }
+    PublishSlot(slot);
+}
 
-        auto colorsValues = mVARequest.GetBlob(mVAOutputNameForColor)->buffer().as<float*>();
-        // 4 possible types for each vehicle and we should select the one with the maximum probability
-        auto typesValues  = mVARequest.GetBlob(mVAOutputNameForType)->buffer().as<float*>();
+void VehicleDetect::OnClassified(size_t slot, InferenceEngine::StatusCode status)
+{
+    SlotClassification& classification = mSlotClassifications[slot];
+    if (StatusCode::OK != status)
+    {
+        std::cerr << "[ ERROR ] Vehicle attributes inference failed with status " << status << std::endl;
+        PublishSlot(slot);
+        return;
+    }
+    try
+    {
+        ReadVABatch(mVARequests[slot], classification.objects, classification.indices, classification.first,
+            classification.count);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "[ ERROR ] Vehicle attributes handling failed: " << e.what() << std::endl;
+        PublishSlot(slot);
+        return;
+    }
+    ClassifyNextBatch(slot);
+}
 
-        const auto color_id = std::max_element(colorsValues, colorsValues + 7) - colorsValues;
-        const auto type_id =  std::max_element(typesValues,  typesValues  + 4) - typesValues;
-        results[i].color = mVAColors[color_id];
-        results[i].type = mVATypes[type_id];
-        //  std::cout<<"Car attribute: "<<results[i].color<<" "<<results[i].type<<"\n";
+void VehicleDetect::PublishSlot(size_t slot)
+{
+    SlotClassification& classification = mSlotClassifications[slot];
+    {
+        // Requests may complete out of order, never replace newer results with older ones
+        std::lock_guard<std::mutex> lock(mResultsLock);
+        LatestResults& latest = mLatestResults[classification.region];
+        if (classification.seq > latest.seq)
+        {
+            latest.seq = classification.seq;
+            latest.objects.swap(classification.objects);
+        }
     }
-    return ;
+    mRequests.Release(slot);
 }
 
+void VehicleDetect::ParseDetections(const float *detections, int batchIdx, const cv::Size& frameSize,
+        std::vector<VehicleDetectResult>& results, int maxObjNum)
+{
+    // Label 1 of the detector is the vehicles, 2 is the license plates
+    SsdDecoder::Decode<SsdDecoder::DetectionSize, 1>(detections, mDetectorMaxProposalCount, batchIdx, mDetectThreshold,
+        [this, &results, &frameSize, maxObjNum](int label, float confidence, float x0, float y0, float x1, float y1) {
+            // The other detections of a mosaic belong to the other sessions
+            if (mMosaic && !DetectionTiles::FromMosaic(mMosaicTile, x0, y0, x1, y1))
+            {
+                return true;
+            }
+            VehicleDetectResult r;
+            r.label = label;
+            r.confidence = confidence;
+            r.location.x = static_cast<int>(x0 * frameSize.width);
+            r.location.y = static_cast<int>(y0 * frameSize.height);
+            r.location.width = static_cast<int>(x1 * frameSize.width - r.location.x);
+            r.location.height = static_cast<int>(y1 * frameSize.height - r.location.y);
+            results.push_back(r);
+            return results.size() < (unsigned int)maxObjNum;
+        });
+}
 
-void VehicleDetect::RenderVDResults(std::vector<VehicleDetectResult>& results, cv::Mat& image)
+void VehicleDetect::RenderVDResults(const std::vector<VehicleDetectResult>& results, FrameCanvas& image)
 {
     for (unsigned int i = 0; i < results.size(); i++) {
-        cv::rectangle(image, results[i].location, cv::Scalar(0, 255, 0), 2);
+        image.Rectangle(results[i].location, cv::Scalar(0, 255, 0), 2);
         std::stringstream va_str;
         va_str<<results[i].color<<" "<<results[i].type;
-        cv::putText(image, va_str.str(), cv::Point(results[i].location.x, results[i].location.y + 20),
+        image.Text(va_str.str(), cv::Point(results[i].location.x, results[i].location.y + 20),
                 cv::FONT_HERSHEY_COMPLEX, 0.8, cv::Scalar(255, 255, 255));
     }
     return;
@@ -166,9 +586,11 @@ void VehicleDetect::RenderVDResults(std::vector<VehicleDetectResult>& results, c
 
 VehicleDetect::~VehicleDetect()
 {
-    if (mEnablePerformanceReport)
+    // The completion handlers use the members below
+    mRequests.WaitAll();
+    if (mEnablePerformanceReport && !mServer)
     {
         std::cout << "Performance counts for vehicle detection:" << std::endl << std::endl;
-        printPerformanceCounts(mDetectorRequest.GetPerformanceCounts(), std::cout, "GPU", false);
+        printPerformanceCounts(mRequests.Request(0).GetPerformanceCounts(), std::cout, "GPU", false);
     }
 }